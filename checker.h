@@ -0,0 +1,61 @@
+#ifndef __CHECKER__H__
+#define __CHECKER__H__
+#include <stdbool.h>
+#include <stddef.h>
+/*----------------------------------------------------------------------------
+ Note: the code in this file is not to be shared with anyone or posted online.
+ (c) Rida Bazzi, 2015, Adam Doupe, 2015
+ ----------------------------------------------------------------------------*/
+
+/* -------------------- CHECKER INTERFACE -------------------- */
+
+/*
+ * The type checker as a library. A checker context holds everything one
+ * check needs and can check any number of programs one after another. Its
+ * tables (names, symbols, type classes, parse stack) and the memory of the
+ * parse tree are kept and reused from one check to the next; the tokens
+ * and the flat copy of the tree the checks walk are freed as each check
+ * ends. Separate contexts can be used on separate threads at the same
+ * time.
+ * Diagnostics ("ERROR CODE ...", syntax errors, "All systems go!") are
+ * passed, formatted exactly as the command line tool prints them, to a
+ * callback given with each check.
+ */
+
+#define CHECKER_API __attribute__((visibility("default")))
+
+struct checker;
+
+struct checker_options
+{
+    int lex_threads;             // 0 = one per online CPU
+    bool recover_syntax_errors;  // report more than the first syntax error
+    int max_syntax_errors;       // stop after this many when recovering
+    bool stop_at_first_error;    // stop reading once the first reported error
+                                 // is known; a declaration error then hides
+                                 // syntax errors further on
+};
+
+typedef void (*checker_diag_fn)(void* user, const char* text);
+
+// Results of check_buffer() and check_file()
+enum
+{
+    CHECK_OK = 0,              // all checks passed
+    CHECK_SEMANTIC_ERROR = 1,  // a check reported an error
+    CHECK_SYNTAX_ERROR = 2,    // the program did not parse
+    CHECK_IO_ERROR = -1        // the input could not be read, see errno
+};
+
+// options may be NULL for the defaults; returns NULL when out of memory
+CHECKER_API struct checker* checker_new(const struct checker_options* options);
+CHECKER_API void checker_free(struct checker* ctx);
+
+// Checks the program in data[0..length), which is not modified
+CHECKER_API int check_buffer(struct checker* ctx, const char* data, size_t length,
+                             checker_diag_fn diag, void* user);
+// Checks the program in the named file, or standard input when path is NULL
+CHECKER_API int check_file(struct checker* ctx, const char* path,
+                           checker_diag_fn diag, void* user);
+
+#endif //__CHECKER__H__
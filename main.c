@@ -0,0 +1,65 @@
+/*----------------------------------------------------------------------------
+ Note: the code in this file is not to be shared with anyone or posted online.
+ (c) Rida Bazzi, 2015, Adam Doupe, 2015
+ ----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "checker.h"
+
+// Diagnostics go to standard output as they are reported
+static void print_diagnostic(void* user, const char* text)
+{
+    fputs(text, (FILE*) user);
+}
+
+int main(int argc, char* argv[])
+{
+    struct checker_options options = { 0, false, 100, false };
+    struct checker* ctx;
+    const char* path;
+    int opt, status;
+
+    while ((opt = getopt(argc, argv, "j:re:s")) != -1)
+    {
+        switch (opt)
+        {
+            case 'j':
+                options.lex_threads = atoi(optarg);
+                break;
+            case 'r':
+                options.recover_syntax_errors = true;
+                break;
+            case 'e':
+                options.max_syntax_errors = atoi(optarg);
+                break;
+            case 's':
+                options.stop_at_first_error = true;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-j lexer_threads] [-r] [-e max_syntax_errors] [-s] [file]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    ctx = checker_new(&options);
+    if (ctx == NULL)
+    {
+        perror(argv[0]);
+        return 1;
+    }
+
+    // The program is read from the file named on the command line,
+    // or from standard input
+    path = optind < argc ? argv[optind] : NULL;
+    status = check_file(ctx, path, print_diagnostic, stdout);
+    if (status == CHECK_IO_ERROR)
+    {
+        perror(path != NULL ? path : "stdin");
+    }
+    checker_free(ctx);
+
+    return status == CHECK_SYNTAX_ERROR || status == CHECK_IO_ERROR ? 1 : 0;
+}
@@ -6,9 +6,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdarg.h>
 #include <string.h>
 #include <ctype.h>
 #include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "checker.h"
 #include "syntax.h"
 
 /* ------------------------------------------------------- */
@@ -29,7 +40,7 @@ typedef enum
     ERROR
 } token_type;
 
-const char *reserved[] = {"",
+static const char *reserved[] = {"",
     "VAR", "WHILE", "INT", "REAL", "STRING", "BOOLEAN",
     "TYPE", "LONG", "DO", "CASE", "SWITCH",
     "+", "-", "/", "*", "=",
@@ -40,152 +51,509 @@ const char *reserved[] = {"",
     "ERROR"
 };
 
-// Global Variables associated with the next input token
-#define MAX_TOKEN_LENGTH 100
-char token[MAX_TOKEN_LENGTH]; // token string
-token_type t_type; // token type
-bool activeToken = false;
-int tokenLength;
-int line_no = 1;
+// Input text, kept in the checker context. A buffer given to
+// check_buffer() is lexed in place. A regular file given to check_file()
+// is mapped read-only and the lexers work directly on the mapping.
+// Anything else (pipes, terminals) is streamed through a fixed-size block
+// buffer, see lexer_refill(), so input memory stays bounded no matter how
+// long the program is.
 
-void skipSpace()
+#define INPUT_BLOCK_SIZE (1 << 16)
+
+// Scanning state. Several lexers can work on disjoint ranges of the
+// mapping at the same time, see tokenize().
+struct lexer
 {
-    char c;
-    
-    c = getchar();
-    line_no += (c == '\n');
-    while (!feof(stdin) && isspace(c))
+    const char *buf;    // text being scanned: the mapping or the block buffer
+    size_t pos;         // next byte to scan in buf
+    size_t end;         // end of the bytes available in buf
+    int line_no;        // newlines seen so far
+    size_t token_start; // start of the current token in buf
+    int tokenLength;
+    uint32_t value;     // ID: name_hash(), NUM: the value, REALNUM: the float bits
+    size_t base;        // input offset of buf[0]
+
+    // Streaming only
+    char *block;        // the block buffer, buf points to it
+    size_t block_size;
+    int fd;             // -1 when there is nothing more to read
+    int read_errno;     // set when reading failed
+};
+
+/*
+ * Reads the next block of a streamed input. Everything before the start
+ * of the current token is dropped to make room, so only a token that is
+ * longer than the whole block makes the buffer grow. Positions in buf are
+ * shifted accordingly. Returns false when no more input is available.
+ */
+static bool lexer_refill(struct lexer* lx)
+{
+    size_t keep = lx->token_start;
+    ssize_t n;
+
+    if (lx->fd < 0)
     {
-        c = getchar();
-        line_no += (c == '\n');
+        return false;
     }
-    ungetc(c, stdin);
+    if (keep > 0)
+    {
+        memmove(lx->block, lx->block + keep, lx->end - keep);
+        lx->pos -= keep;
+        lx->end -= keep;
+        lx->token_start = 0;
+        lx->base += keep;
+    }
+    if (lx->end == lx->block_size)
+    {
+        lx->block_size *= 2;
+        lx->block = realloc(lx->block, lx->block_size);
+        lx->buf = lx->block;
+    }
+    do
+    {
+        n = read(lx->fd, lx->block + lx->end, lx->block_size - lx->end);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0)
+    {
+        // A failed read ends the input; lex_more() reports it
+        lx->read_errno = n < 0 ? errno : 0;
+        lx->fd = -1;
+        return false;
+    }
+    lx->end += n;
+    return true;
 }
 
-int isKeyword(char *s)
+// True when the byte k positions after lx->pos exists, reading it in if needed
+static inline bool lexer_ahead(struct lexer* lx, size_t k)
 {
-    int i;
-    
-    for (i = 1; i <= KEYWORDS; i++)
+    while (lx->pos + k >= lx->end)
     {
-        if (strcmp(reserved[i], s) == 0)
+        if (!lexer_refill(lx))
         {
-            return i;
+            return false;
         }
     }
-    return false;
+    return true;
 }
 
+/* -------------------- CHARACTER RUN SCANNING -------------------- */
+
 /*
- * ungetToken() simply sets a flag so that when getToken() is called
- * the old t_type is returned and the old token is not overwritten.
- * NOTE: BETWEEN ANY TWO SEPARATE CALLS TO ungetToken() THERE MUST BE
- * AT LEAST ONE CALL TO getToken(). CALLING TWO ungetToken() WILL NOT
- * UNGET TWO TOKENS
+ * The lexer spends most of its time walking runs of whitespace, identifier
+ * characters and digits. Each run scanner returns the position of the
+ * first byte in [pos, end) outside its class. skip_space_run() also adds
+ * the newlines it passed to *lines. Vector versions look at 16 (SSE2) or
+ * 32 (AVX2) bytes per step, the best one is picked at startup by
+ * init_scanners(). Character classes are plain ASCII, as in the C locale.
+ * Build with -DSEMANTIC_NO_SIMD to force the scalar versions.
  */
-void ungetToken()
+
+static inline bool is_space_char(unsigned char c)
 {
-    activeToken = true;
+    return c == ' ' || (unsigned char) (c - '\t') <= '\r' - '\t';
 }
 
-token_type scan_number()
+static inline bool is_digit_char(unsigned char c)
 {
-    char c;
-    
-    c = getchar();
-    if (isdigit(c))
+    return (unsigned char) (c - '0') <= 9;
+}
+
+static inline bool is_alpha_char(unsigned char c)
+{
+    return (unsigned char) ((c | 0x20) - 'a') <= 'z' - 'a';
+}
+
+static inline bool is_alnum_char(unsigned char c)
+{
+    return is_digit_char(c) || is_alpha_char(c);
+}
+
+static size_t skip_space_scalar(const char *s, size_t pos, size_t end, int *lines)
+{
+    int newlines = 0;
+
+    while (pos < end && is_space_char(s[pos]))
     {
-        // First collect leading digits before dot
-        // 0 is a NUM by itself
-        if (c == '0')
+        newlines += (s[pos] == '\n');
+        pos++;
+    }
+    *lines += newlines;
+    return pos;
+}
+
+static size_t skip_alnum_scalar(const char *s, size_t pos, size_t end)
+{
+    while (pos < end && is_alnum_char(s[pos]))
+    {
+        pos++;
+    }
+    return pos;
+}
+
+static size_t skip_digit_scalar(const char *s, size_t pos, size_t end)
+{
+    while (pos < end && is_digit_char(s[pos]))
+    {
+        pos++;
+    }
+    return pos;
+}
+
+#if !defined(SEMANTIC_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SEMANTIC_X86_SIMD 1
+#include <immintrin.h>
+
+// Unsigned "lo <= v <= lo + span" on every byte
+#define SSE2_IN_RANGE(v, lo, span) \
+    _mm_cmpeq_epi8(_mm_min_epu8(_mm_sub_epi8(v, _mm_set1_epi8(lo)), _mm_set1_epi8(span)), \
+                   _mm_sub_epi8(v, _mm_set1_epi8(lo)))
+#define AVX2_IN_RANGE(v, lo, span) \
+    _mm256_cmpeq_epi8(_mm256_min_epu8(_mm256_sub_epi8(v, _mm256_set1_epi8(lo)), _mm256_set1_epi8(span)), \
+                      _mm256_sub_epi8(v, _mm256_set1_epi8(lo)))
+
+__attribute__((target("sse2")))
+static size_t skip_space_sse2(const char *s, size_t pos, size_t end, int *lines)
+{
+    while (pos + 16 <= end)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *) (s + pos));
+        __m128i space = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                     SSE2_IN_RANGE(v, '\t', '\r' - '\t'));
+        unsigned int newline = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        unsigned int other = ~_mm_movemask_epi8(space) & 0xFFFF;
+
+        if (other != 0)
         {
-            token[tokenLength] = c;
-            tokenLength++;
-            token[tokenLength] = '\0';
+            int n = __builtin_ctz(other);
+            *lines += __builtin_popcount(newline & ((1u << n) - 1));
+            return pos + n;
         }
-        else
+        *lines += __builtin_popcount(newline);
+        pos += 16;
+    }
+    return skip_space_scalar(s, pos, end, lines);
+}
+
+__attribute__((target("sse2")))
+static size_t skip_alnum_sse2(const char *s, size_t pos, size_t end)
+{
+    while (pos + 16 <= end)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *) (s + pos));
+        __m128i alnum = _mm_or_si128(SSE2_IN_RANGE(v, '0', 9),
+                                     SSE2_IN_RANGE(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z' - 'a'));
+        unsigned int other = ~_mm_movemask_epi8(alnum) & 0xFFFF;
+
+        if (other != 0)
         {
-            while (isdigit(c))
-            {
-                token[tokenLength] = c;
-                tokenLength++;
-                c = getchar();
-            }
-            ungetc(c, stdin);
-            token[tokenLength] = '\0';
+            return pos + __builtin_ctz(other);
         }
-        // Check if leading digits are integer part of a REALNUM
-        c = getchar();
-        if (c == '.')
+        pos += 16;
+    }
+    return skip_alnum_scalar(s, pos, end);
+}
+
+__attribute__((target("sse2")))
+static size_t skip_digit_sse2(const char *s, size_t pos, size_t end)
+{
+    while (pos + 16 <= end)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *) (s + pos));
+        unsigned int other = ~_mm_movemask_epi8(SSE2_IN_RANGE(v, '0', 9)) & 0xFFFF;
+
+        if (other != 0)
         {
-            c = getchar();
-            if (isdigit(c))
-            {
-                token[tokenLength] = '.';
-                tokenLength++;
-                while (isdigit(c))
-                {
-                    token[tokenLength] = c;
-                    tokenLength++;
-                    c = getchar();
-                }
-                token[tokenLength] = '\0';
-                if (!feof(stdin))
-                {
-                    ungetc(c, stdin);
-                }
-                return REALNUM;
-            }
-            else
-            {
-                ungetc(c, stdin);
-                c = '.';
-                ungetc(c, stdin);
-                return NUM;
-            }
+            return pos + __builtin_ctz(other);
         }
-        else
+        pos += 16;
+    }
+    return skip_digit_scalar(s, pos, end);
+}
+
+__attribute__((target("avx2")))
+static size_t skip_space_avx2(const char *s, size_t pos, size_t end, int *lines)
+{
+    while (pos + 32 <= end)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (s + pos));
+        __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                        AVX2_IN_RANGE(v, '\t', '\r' - '\t'));
+        unsigned int newline = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        unsigned int other = ~(unsigned int) _mm256_movemask_epi8(space);
+
+        if (other != 0)
         {
-            ungetc(c, stdin);
-            return NUM;
+            int n = __builtin_ctz(other);
+            *lines += __builtin_popcount(newline & ((1u << n) - 1));
+            return pos + n;
         }
+        *lines += __builtin_popcount(newline);
+        pos += 32;
     }
-    else
+    return skip_space_sse2(s, pos, end, lines);
+}
+
+__attribute__((target("avx2")))
+static size_t skip_alnum_avx2(const char *s, size_t pos, size_t end)
+{
+    while (pos + 32 <= end)
     {
-        return ERROR;
+        __m256i v = _mm256_loadu_si256((const __m256i *) (s + pos));
+        __m256i alnum = _mm256_or_si256(AVX2_IN_RANGE(v, '0', 9),
+                                        AVX2_IN_RANGE(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z' - 'a'));
+        unsigned int other = ~(unsigned int) _mm256_movemask_epi8(alnum);
+
+        if (other != 0)
+        {
+            return pos + __builtin_ctz(other);
+        }
+        pos += 32;
+    }
+    return skip_alnum_sse2(s, pos, end);
+}
+
+__attribute__((target("avx2")))
+static size_t skip_digit_avx2(const char *s, size_t pos, size_t end)
+{
+    while (pos + 32 <= end)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (s + pos));
+        unsigned int other = ~(unsigned int) _mm256_movemask_epi8(AVX2_IN_RANGE(v, '0', 9));
+
+        if (other != 0)
+        {
+            return pos + __builtin_ctz(other);
+        }
+        pos += 32;
+    }
+    return skip_digit_sse2(s, pos, end);
+}
+#endif
+
+static size_t (*skip_space_run)(const char *s, size_t pos, size_t end, int *lines) = skip_space_scalar;
+static size_t (*skip_alnum_run)(const char *s, size_t pos, size_t end) = skip_alnum_scalar;
+static size_t (*skip_digit_run)(const char *s, size_t pos, size_t end) = skip_digit_scalar;
+
+static void init_scanners()
+{
+#ifdef SEMANTIC_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        skip_space_run = skip_space_avx2;
+        skip_alnum_run = skip_alnum_avx2;
+        skip_digit_run = skip_digit_avx2;
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        skip_space_run = skip_space_sse2;
+        skip_alnum_run = skip_alnum_sse2;
+        skip_digit_run = skip_digit_sse2;
+    }
+#endif
+}
+
+static void skipSpace(struct lexer* lx)
+{
+    for (;;)
+    {
+        lx->pos = skip_space_run(lx->buf, lx->pos, lx->end, &lx->line_no);
+        lx->token_start = lx->pos;
+        if (lx->pos < lx->end || !lexer_refill(lx))
+        {
+            return;
+        }
+    }
+}
+
+static void skip_digits(struct lexer* lx)
+{
+    lx->pos = skip_digit_run(lx->buf, lx->pos, lx->end);
+    while (lx->pos == lx->end && lexer_refill(lx))
+    {
+        lx->pos = skip_digit_run(lx->buf, lx->pos, lx->end);
+    }
+}
+
+static void skip_alnums(struct lexer* lx)
+{
+    lx->pos = skip_alnum_run(lx->buf, lx->pos, lx->end);
+    while (lx->pos == lx->end && lexer_refill(lx))
+    {
+        lx->pos = skip_alnum_run(lx->buf, lx->pos, lx->end);
     }
 }
 
-token_type scan_id_or_keyword()
+/*
+ * Keywords are recognized with a perfect hash over reserved[1..KEYWORDS]:
+ * (first char + 9 * last char + length) mod 16 is distinct for every
+ * keyword, so one table probe and one string compare classify any
+ * identifier.
+ * keyword_slot[] maps a hash value to its reserved[] index (0 = none) and
+ * has to be regenerated if a keyword is added.
+ */
+#define KEYWORD_HASH(s, len) \
+    (((unsigned char) (s)[0] + 9 * (unsigned char) (s)[(len) - 1] + (len)) & 15)
+#define KEYWORD_MAX_LENGTH 7
+
+static const unsigned char keyword_slot[16] = {
+    INT, SWITCH, REAL, 0, CASE, TYPE, 0, BOOLEAN,
+    STRING, WHILE, 0, VAR, 0, DO, 0, LONG
+};
+
+static int isKeyword(const char *s, int len)
 {
-    token_type the_type;
     int k;
-    char c;
-    
-    c = getchar();
-    if (isalpha(c))
+
+    if (len < 2 || len > KEYWORD_MAX_LENGTH)
+    {
+        return false;
+    }
+    k = keyword_slot[KEYWORD_HASH(s, len)];
+    if (k != 0 && strncmp(reserved[k], s, len) == 0 && reserved[k][len] == '\0')
+    {
+        return k;
+    }
+    return false;
+}
+
+// FNV-1a hash of an identifier, the interner uses it to find the name
+static inline uint32_t name_hash(const char* s, int length)
+{
+    uint32_t h = 2166136261u;
+    int i;
+
+    for (i = 0; i < length; i++)
+    {
+        h = (h ^ (unsigned char) s[i]) * 16777619u;
+    }
+    return h;
+}
+
+/*
+ * Numbers are converted by the scanner, the parser never reads their text.
+ * A NUM value is 0..INT_MAX as it has to fit in an int; a literal that
+ * does not fit gets NUM_OVERFLOW, which the parser reports. A REALNUM is
+ * kept as the bits of its float value.
+ */
+#define NUM_OVERFLOW UINT32_MAX
+
+static uint32_t num_value(const char* s, int length)
+{
+    uint64_t value = 0;
+    int i;
+
+    for (i = 0; i < length; i++)
+    {
+        value = value * 10 + (s[i] - '0');
+        if (value > 0x7FFFFFFF)
+        {
+            return NUM_OVERFLOW;
+        }
+    }
+    return (uint32_t) value;
+}
+
+static const double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static uint32_t real_value(const char* s, int length)
+{
+    uint64_t mantissa = 0;
+    int digits = 0, fraction = 0;
+    bool in_fraction = false;
+    char buf[64];
+    char *copy;
+    double d;
+    float f;
+    uint32_t bits;
+    int i;
+
+    for (i = 0; i < length; i++)
+    {
+        if (s[i] == '.')
+        {
+            in_fraction = true;
+            continue;
+        }
+        mantissa = mantissa * 10 + (s[i] - '0');
+        digits++;
+        fraction += in_fraction;
+    }
+    if (digits <= 19 && mantissa <= (UINT64_C(1) << 53) && fraction <= 22)
+    {
+        // Both operands are exact doubles, so the quotient is correctly
+        // rounded, the same double strtod() gives
+        d = (double) mantissa / exact_powers_of_ten[fraction];
+    }
+    else
     {
-        while (isalnum(c))
+        copy = length < (int) sizeof(buf) ? buf : malloc(length + 1);
+        memcpy(copy, s, length);
+        copy[length] = '\0';
+        d = strtod(copy, NULL);
+        if (copy != buf)
+        {
+            free(copy);
+        }
+    }
+    f = (float) d;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+// scan_number() and scan_id_or_keyword() expect lx->token_start == lx->pos
+static token_type scan_number(struct lexer* lx)
+{
+    if (lexer_ahead(lx, 0) && is_digit_char(lx->buf[lx->pos]))
+    {
+        // First collect leading digits before dot
+        // 0 is a NUM by itself
+        if (lx->buf[lx->pos++] != '0')
         {
-            token[tokenLength] = c;
-            tokenLength++;
-            c = getchar();
+            skip_digits(lx);
         }
-        if (!feof(stdin))
+        // Check if leading digits are integer part of a REALNUM
+        if (lexer_ahead(lx, 1) && lx->buf[lx->pos] == '.' && is_digit_char(lx->buf[lx->pos + 1]))
         {
-            ungetc(c, stdin);
+            lx->pos += 2;
+            skip_digits(lx);
+            lx->tokenLength = lx->pos - lx->token_start;
+            lx->value = real_value(lx->buf + lx->token_start, lx->tokenLength);
+            return REALNUM;
         }
-        token[tokenLength] = '\0';
-        k = isKeyword(token);
+        lx->tokenLength = lx->pos - lx->token_start;
+        lx->value = num_value(lx->buf + lx->token_start, lx->tokenLength);
+        return NUM;
+    }
+    else
+    {
+        return ERROR;
+    }
+}
+
+static token_type scan_id_or_keyword(struct lexer* lx)
+{
+    int k;
+
+    if (lexer_ahead(lx, 0) && is_alpha_char(lx->buf[lx->pos]))
+    {
+        lx->pos++;
+        skip_alnums(lx);
+        lx->tokenLength = lx->pos - lx->token_start;
+        k = isKeyword(lx->buf + lx->token_start, lx->tokenLength);
         if (k == 0)
         {
-            the_type = ID;
+            lx->value = name_hash(lx->buf + lx->token_start, lx->tokenLength);
+            return ID;
         }
         else
         {
-            the_type = (token_type) k;
+            return (token_type) k;
         }
-        return the_type;
     }
     else
     {
@@ -193,18 +561,18 @@ token_type scan_id_or_keyword()
     }
 }
 
-token_type getToken()
+static token_type scan_token(struct lexer* lx)
 {
     char c;
-    
-    if (activeToken)
+
+    skipSpace(lx);
+    lx->tokenLength = 0;
+    if (lx->pos >= lx->end)
     {
-        activeToken = false;
-        return t_type;
+        return END_OF_FILE;
     }
-    skipSpace();
-    tokenLength = 0;
-    c = getchar();
+    c = lx->buf[lx->pos++];
+    lx->tokenLength = 1;
     switch (c)
     {
         case '.': return DOT;
@@ -223,45 +591,43 @@ token_type getToken()
         case '{': return LBRACE;
         case '}': return RBRACE;
         case '<':
-            c = getchar();
-            if (c == '=')
+            if (lexer_ahead(lx, 0) && lx->buf[lx->pos] == '=')
             {
+                lx->pos++;
+                lx->tokenLength = 2;
                 return LTEQ;
             }
-            else if (c == '>')
+            else if (lexer_ahead(lx, 0) && lx->buf[lx->pos] == '>')
             {
+                lx->pos++;
+                lx->tokenLength = 2;
                 return NOTEQUAL;
             }
             else
             {
-                ungetc(c, stdin);
                 return LESS;
             }
         case '>':
-            c = getchar();
-            if (c == '=')
+            if (lexer_ahead(lx, 0) && lx->buf[lx->pos] == '=')
             {
+                lx->pos++;
+                lx->tokenLength = 2;
                 return GTEQ;
             }
             else
             {
-                ungetc(c, stdin);
                 return GREATER;
             }
         default:
-            if (isdigit(c))
-            {
-                ungetc(c, stdin);
-                return scan_number();
-            }
-            else if (isalpha(c))
+            if (is_digit_char(c))
             {
-                ungetc(c, stdin);
-                return scan_id_or_keyword();
+                lx->pos--;
+                return scan_number(lx);
             }
-            else if (c == EOF)
+            else if (is_alpha_char(c))
             {
-                return END_OF_FILE;
+                lx->pos--;
+                return scan_id_or_keyword(lx);
             }
             else
             {
@@ -270,1266 +636,3248 @@ token_type getToken()
     }
 }
 
-/* ----------------------------------------------------------------- */
-/* -------------------- SYNTAX ANALYSIS SECTION -------------------- */
-/* ----------------------------------------------------------------- */
+/* -------------------- ARENA -------------------- */
+
+/*
+ * The parse tree and the identifier names each live in a bump-pointer
+ * arena: an allocation is an aligned pointer increment inside the current
+ * chunk, and arena_release() drops everything at once by rewinding to the
+ * first chunk. Chunks are kept for the next program; arena_free() returns
+ * them. Memory comes back zeroed, like the calloc() it replaces.
+ */
+#define ARENA_CHUNK_SIZE (1 << 16)
 
-void syntax_error(const char* msg)
+struct arena_chunk
 {
-    printf("Syntax error while parsing %s line %d\n", msg, line_no);
-    exit(1);
-}
+    struct arena_chunk* next;
+    size_t size;
+    max_align_t data[];
+};
 
-/* -------------------- PRINTING PARSE TREE -------------------- */
-void print_parse_tree(struct programNode* program)
+struct arena
 {
-    print_decl(program->decl);
-    print_body(program->body);
-}
+    struct arena_chunk* first;
+    struct arena_chunk* current;
+    size_t used; // bytes used in current
+};
 
-void print_decl(struct declNode* dec)
+static void* arena_alloc(struct arena* a, size_t size, size_t align)
 {
-    if (dec->type_decl_section != NULL)
+    struct arena_chunk* chunk = a->current;
+    size_t start;
+
+    if (chunk != NULL)
+    {
+        start = (a->used + align - 1) & ~(align - 1);
+        if (start + size <= chunk->size)
+        {
+            a->used = start + size;
+            return memset((char *) chunk->data + start, 0, size);
+        }
+    }
+
+    // Move on to the next kept chunk if it is big enough, else add one
+    if (chunk != NULL && chunk->next != NULL && chunk->next->size >= size)
     {
-        print_type_decl_section(dec->type_decl_section);
+        chunk = chunk->next;
     }
-    if (dec->var_decl_section != NULL)
+    else
     {
-        print_var_decl_section(dec->var_decl_section);
+        struct arena_chunk* fresh;
+        size_t chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+
+        fresh = malloc(sizeof(struct arena_chunk) + chunk_size);
+        fresh->size = chunk_size;
+        if (chunk == NULL)
+        {
+            fresh->next = a->first;
+            a->first = fresh;
+        }
+        else
+        {
+            fresh->next = chunk->next;
+            chunk->next = fresh;
+        }
+        chunk = fresh;
     }
+    a->current = chunk;
+    a->used = size;
+    return memset(chunk->data, 0, size);
 }
 
-void print_body(struct bodyNode* body)
+static void arena_release(struct arena* a)
 {
-    //printf("{\n");
-    print_stmt_list(body->stmt_list);
-    //printf("}\n");
+    a->current = a->first;
+    a->used = 0;
 }
 
-void print_var_decl_section(struct var_decl_sectionNode* varDeclSection)
+static void arena_free(struct arena* a)
 {
-    var_section_accessed = 1;
-    //printf("VAR\n");
-    if (varDeclSection->var_decl_list != NULL)
+    struct arena_chunk* chunk = a->first;
+    struct arena_chunk* next;
+
+    while (chunk != NULL)
     {
-        print_var_decl_list(varDeclSection->var_decl_list);
+        next = chunk->next;
+        free(chunk);
+        chunk = next;
     }
+    memset(a, 0, sizeof(*a));
 }
 
-void print_var_decl_list(struct var_decl_listNode* varDeclList)
+/* -------------------- IDENTIFIER INTERNING -------------------- */
+
+/*
+ * Every distinct identifier is stored once and named by a symbol (see
+ * syntax.h), a small integer. Symbols are numbered from 1 so that 0 can
+ * mean "no name". Comparing two names is comparing their symbols. The
+ * names themselves are kept in an arena of their own, so they outlive the
+ * parse tree and go when the check ends.
+ */
+struct interner
+{
+    symbol* slots;      // open addressing on the name hash, 0 = empty
+    uint32_t mask;      // number of slots - 1
+    uint32_t* hash;     // per symbol
+    const char** name;  // per symbol, NUL terminated
+    uint32_t* length;   // per symbol
+    uint32_t count;     // symbols in use are 1..count
+    uint32_t capacity;
+    struct arena* text; // where the names are copied to
+};
+
+static void grow_interner(struct interner* in)
 {
-    print_var_decl(varDeclList->var_decl);
-    if (varDeclList->var_decl_list != NULL)
+    uint32_t size, i, sym;
+
+    size = in->slots ? 2 * (in->mask + 1) : 1024;
+    free(in->slots);
+    in->slots = calloc(size, sizeof(*in->slots));
+    in->mask = size - 1;
+    for (sym = 1; sym <= in->count; sym++)
     {
-        print_var_decl_list(varDeclList->var_decl_list);
+        i = in->hash[sym] & in->mask;
+        while (in->slots[i] != 0)
+        {
+            i = (i + 1) & in->mask;
+        }
+        in->slots[i] = sym;
     }
+    in->capacity = size / 2;
+    in->hash = realloc(in->hash, (in->capacity + 1) * sizeof(*in->hash));
+    in->name = realloc(in->name, (in->capacity + 1) * sizeof(*in->name));
+    in->length = realloc(in->length, (in->capacity + 1) * sizeof(*in->length));
 }
 
-void print_var_decl(struct var_declNode* varDecl)
+static symbol intern(struct interner* in, const char* s, uint32_t length, uint32_t hash)
 {
-    print_id_list(varDecl->id_list);
-    //printf(": ");
-    print_type_name(varDecl->type_name);
-    //printf(";\n");
-}
+    uint32_t i;
+    symbol sym;
+    char* copy;
 
-void print_type_decl_section(struct type_decl_sectionNode* typeDeclSection)
-{
-    //printf("TYPE\n");
-    if (typeDeclSection->type_decl_list != NULL)
+    if (in->count == in->capacity)
     {
-        print_type_decl_list(typeDeclSection->type_decl_list);
+        grow_interner(in);
     }
+    i = hash & in->mask;
+    while ((sym = in->slots[i]) != 0)
+    {
+        if (in->hash[sym] == hash && in->length[sym] == length &&
+            memcmp(in->name[sym], s, length) == 0)
+        {
+            return sym;
+        }
+        i = (i + 1) & in->mask;
+    }
+    copy = arena_alloc(in->text, length + 1, 1);
+    memcpy(copy, s, length);
+    sym = ++in->count;
+    in->slots[i] = sym;
+    in->hash[sym] = hash;
+    in->length[sym] = length;
+    in->name[sym] = copy;
+    return sym;
 }
 
-void print_type_decl_list(struct type_decl_listNode* typeDeclList)
+// Forgets all names, for when the tree arena is released
+static void clear_interner(struct interner* in)
 {
-    print_type_decl(typeDeclList->type_decl);
-    if (typeDeclList->type_decl_list != NULL)
+    if (in->slots != NULL)
     {
-        print_type_decl_list(typeDeclList->type_decl_list);
+        memset(in->slots, 0, (in->mask + 1) * sizeof(*in->slots));
     }
+    in->count = 0;
 }
 
-void print_type_decl(struct type_declNode* typeDecl)
+static void free_interner(struct interner* in)
 {
-    print_id_list(typeDecl->id_list);
-    //printf(": ");
-    print_type_name(typeDecl->type_name);
-    //printf(";\n");
+    free(in->slots);
+    free(in->hash);
+    free(in->name);
+    free(in->length);
+    in->slots = NULL;
+    in->hash = NULL;
+    in->name = NULL;
+    in->length = NULL;
+    in->mask = 0;
+    in->count = 0;
+    in->capacity = 0;
 }
 
-void print_type_name(struct type_nameNode* typeName)
+/* -------------------- SYMBOL TABLE -------------------- */
+
+/*
+ * One entry per name the program mentions, found by open addressing on
+ * its symbol. The declaration checks fill it in as they go, see
+ * report_declaration_errors(), and so do the uses in the body, see
+ * use_variable_name(); with constant time lookups they take expected O(N)
+ * in all instead of comparing every pair of names.
+ */
+#define SYM_TYPE     1 // declared in the TYPE section
+#define SYM_VAR      2 // declared in the VAR section
+#define SYM_IMPLICIT 4 // a variable declared by its first use in the body
+
+struct symbol_entry
 {
-    
-    if (var_section_accessed == 1) {
+    symbol sym;
+    int kind;       // SYM_TYPE | SYM_VAR | SYM_IMPLICIT, 0 when only used as a type name
+    int line;       // line of the first declaration
+    int type;       // type it was first declared with: INT, REAL, ... or ID
+    symbol type_id; // the type name when type is ID
+    // Positions in the declaration order, -1 for none
+    int first_type; // of its first and last declaration as a type name
+    int last_type;
+    int first_var;  // of its first and last declaration as a variable
+    int last_var;
+    int first_use;  // of the first var_decl that names it as its type
+    uint32_t type_class; // root of its type class, cached by
+                         // resolve_type_aliases(), UINT32_MAX until then
+};
 
-        if (typeName->type != ID)
-        {
-            // printf("%s ", reserved[typeName->type]);
-            var_assigns[var_assign_count] = reserved[typeName->type];
-            var_assign_count+=1;
-        }
-        else
-        {
-            // printf("%s ", typeName->id);
-            var_assigns[var_assign_count] = typeName->id;
-            var_assign_count+=1;
-        }
-    }
-    
+struct symbol_table
+{
+    uint32_t* slots;  // entry index + 1, 0 = empty
+    uint32_t mask;    // number of slots - 1
+    struct symbol_entry* entry;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+static inline uint32_t symbol_slot(symbol sym)
+{
+    return sym * 2654435761u;
 }
 
-void print_id_list(struct id_listNode* idList)
+static void grow_symbol_table(struct symbol_table* st)
 {
-    //printf("%s ", idList->id);
-    // printf("CURRENT ID IS: %s\n", idList->id);
-    if (var_section_accessed == 0) {
-        type_ids[type_id_count] = idList->id;
-        type_id_count+=1;
-    }
-    else if (var_section_accessed == 1) {
-        // printf("CURRENT ID IS: %s\n", idList->id);
-        var_ids[var_id_count] = idList->id;
-        var_id_count+=1;
-    }
+    uint32_t size, i, e;
 
-    if (idList->id_list != NULL)
+    size = st->slots ? 2 * (st->mask + 1) : 256;
+    free(st->slots);
+    st->slots = calloc(size, sizeof(*st->slots));
+    st->mask = size - 1;
+    for (e = 0; e < st->count; e++)
     {
-        //printf(", ");
-        print_id_list(idList->id_list);
+        i = symbol_slot(st->entry[e].sym) & st->mask;
+        while (st->slots[i] != 0)
+        {
+            i = (i + 1) & st->mask;
+        }
+        st->slots[i] = e + 1;
     }
+    st->capacity = size / 2;
+    st->entry = realloc(st->entry, st->capacity * sizeof(*st->entry));
 }
 
-void print_stmt_list(struct stmt_listNode* stmt_list)
+static struct symbol_entry* symbol_lookup(struct symbol_table* st, symbol sym)
 {
-    print_stmt(stmt_list->stmt);
-    if (stmt_list->stmt_list != NULL)
+    uint32_t i, e;
+
+    if (st->slots == NULL)
+    {
+        return NULL;
+    }
+    i = symbol_slot(sym) & st->mask;
+    while ((e = st->slots[i]) != 0)
     {
-        print_stmt_list(stmt_list->stmt_list);
+        if (st->entry[e - 1].sym == sym)
+        {
+            return &st->entry[e - 1];
+        }
+        i = (i + 1) & st->mask;
     }
-    
+    return NULL;
 }
 
-void print_assign_stmt(struct assign_stmtNode* assign_stmt)
+// Returns the entry of sym, adding an empty one if there is none
+static struct symbol_entry* symbol_insert(struct symbol_table* st, symbol sym)
 {
-    // printf("%s ", assign_stmt->id);
-    //printf("= ");
-    print_expression_prefix(assign_stmt->expr);
-    //printf("; \n");
-}
+    struct symbol_entry* entry;
+    uint32_t i, e;
 
-void print_stmt(struct stmtNode* stmt)
-{
-    switch (stmt->stmtType)
+    if (st->count == st->capacity)
     {
-        case ASSIGN:
-            print_assign_stmt(stmt->assign_stmt);
-            break;
-        case WHILE:
-            print_while_stmt(stmt->while_stmt);
-            break;
-        case DO:
-            print_do_stmt(stmt->while_stmt);
-            break;
-        case SWITCH:
-            print_switch_stmt(stmt->switch_stmt);
-            break;
+        grow_symbol_table(st);
     }
+    i = symbol_slot(sym) & st->mask;
+    while ((e = st->slots[i]) != 0)
+    {
+        if (st->entry[e - 1].sym == sym)
+        {
+            return &st->entry[e - 1];
+        }
+        i = (i + 1) & st->mask;
+    }
+    st->slots[i] = st->count + 1;
+    entry = &st->entry[st->count++];
+    memset(entry, 0, sizeof(*entry));
+    entry->sym = sym;
+    entry->first_type = -1;
+    entry->last_type = -1;
+    entry->first_var = -1;
+    entry->last_var = -1;
+    entry->first_use = -1;
+    entry->type_class = UINT32_MAX;
+    return entry;
 }
 
-void print_expression_prefix(struct exprNode* expr)
+static void clear_symbol_table(struct symbol_table* st)
 {
-    if (expr->tag == EXPR)
+    if (st->slots != NULL)
     {
-        //printf("%s ", reserved[expr->op]);
-        print_expression_prefix(expr->leftOperand);
-        print_expression_prefix(expr->rightOperand);
-    }
-    else if (expr->tag == PRIMARY)
-    {
-        if (expr->primary->tag == ID)
-        {
-            //printf("%s ", expr->primary->id);
-        }
-        else if (expr->primary->tag == NUM)
-        {
-            //printf("%d ", expr->primary->ival);
-        }
-        else if (expr->primary->tag == REALNUM)
-        {
-            //printf("%.4f ", expr->primary->fval);
-        }
+        memset(st->slots, 0, (st->mask + 1) * sizeof(*st->slots));
     }
+    st->count = 0;
 }
 
-void print_while_stmt(struct while_stmtNode* while_stmt)
+static void free_symbol_table(struct symbol_table* st)
 {
-    //printf("WHILE ");
-    print_condition(while_stmt->condition);
-    print_body(while_stmt->body);
+    free(st->slots);
+    free(st->entry);
+    memset(st, 0, sizeof(*st));
 }
 
-void print_do_stmt(struct while_stmtNode* do_stmt)
-{
-    // TODO: implement this for your own debugging purposes
+/* -------------------- TYPE EQUIVALENCE -------------------- */
 
-    //printf("DO ");
-    print_body(do_stmt->body);
-    //printf("WHILE ");
-    print_condition(do_stmt->condition);
-    //printf("\n");
-}
+/*
+ * Types that declarations make equal are kept as classes of a union-find
+ * forest. Nodes 0..BUILTIN_TYPES-1 are the built in types, node
+ * BUILTIN_TYPES + e is the name of symbol table entry e. A class that
+ * holds a built in type always has it as its root, so the root of a name
+ * tells its base type. With path compression and union by rank a run of
+ * finds and unions takes near-linear time.
+ */
+#define BUILTIN_TYPES 5 // INT, REAL, STRING, BOOLEAN, LONG
 
-void print_condition(struct conditionNode* condition)
+struct type_classes
 {
+    uint32_t* parent;
+    uint8_t* rank;
+    uint32_t count;    // nodes 0..count-1 exist
+    uint32_t capacity;
+};
 
-    if (condition->left_operand->tag == NUM){
-        //printf("%d", condition->left_operand->ival);
+// Adds nodes up to node n, each a class of its own
+static void make_type_nodes(struct type_classes* tc, uint32_t n)
+{
+    if (n < tc->count)
+    {
+        return;
     }
-
-    else if(condition->left_operand->tag == REALNUM) {
-        //printf("%.4f", condition->left_operand->fval);
+    if (n >= tc->capacity)
+    {
+        tc->capacity = tc->capacity ? 2 * tc->capacity : 256;
+        if (tc->capacity <= n)
+        {
+            tc->capacity = n + 1;
+        }
+        tc->parent = realloc(tc->parent, tc->capacity * sizeof(*tc->parent));
+        tc->rank = realloc(tc->rank, tc->capacity * sizeof(*tc->rank));
     }
-
-    else if(condition->left_operand->tag == ID) {
-        //printf("%s", condition->left_operand->id);
+    for (; tc->count <= n; tc->count++)
+    {
+        tc->parent[tc->count] = tc->count;
+        tc->rank[tc->count] = 0;
     }
+}
 
-    if (condition->right_operand != NULL) {
-
-        //printf("%s", reserved[condition->relop]);
+static uint32_t find_type(struct type_classes* tc, uint32_t node)
+{
+    uint32_t root = node;
+    uint32_t next;
 
-        if (condition->right_operand->tag == NUM){
-            //printf("%d", condition->right_operand->ival);
-        }
+    while (tc->parent[root] != root)
+    {
+        root = tc->parent[root];
+    }
+    while (tc->parent[node] != root)
+    {
+        next = tc->parent[node];
+        tc->parent[node] = root;
+        node = next;
+    }
+    return root;
+}
 
-        else if(condition->right_operand->tag == REALNUM) {
-            //printf("%.4f", condition->right_operand->fval);
+// Makes the classes of a and b one; a built in type stays the root, and of
+// two different built in types the one of a is kept
+static void unite_types(struct type_classes* tc, uint32_t a, uint32_t b)
+{
+    a = find_type(tc, a);
+    b = find_type(tc, b);
+    if (a == b)
+    {
+        return;
+    }
+    if (a < BUILTIN_TYPES || (b >= BUILTIN_TYPES && tc->rank[a] >= tc->rank[b]))
+    {
+        tc->parent[b] = a;
+        if (tc->rank[a] == tc->rank[b])
+        {
+            tc->rank[a]++;
         }
-
-        else if(condition->right_operand->tag == ID) {
-            //printf("%s", condition->right_operand->id);
+    }
+    else
+    {
+        tc->parent[a] = b;
+        if (tc->rank[a] == tc->rank[b])
+        {
+            tc->rank[b]++;
         }
-
     }
-
 }
 
-void print_case(struct caseNode* cas)
+static void free_type_classes(struct type_classes* tc)
 {
-    // TODO: implement this for your own debugging purposes
+    free(tc->parent);
+    free(tc->rank);
+    memset(tc, 0, sizeof(*tc));
 }
 
-void print_case_list(struct case_listNode* case_list)
+// A declaration error and the position it is ordered by
+struct decl_report
 {
-    // TODO: implement this for your own debugging purposes
-}
+    int index;
+    symbol sym;
+};
 
-void print_switch_stmt(struct switch_stmtNode* switc)
+struct decl_reports
 {
-    // TODO: implement this for your own debugging purposes
-}
-
-/* -------------------- PARSING AND BUILDING PARSE TREE -------------------- */
+    struct decl_report* report;
+    int count;
+    int capacity;
+};
 
-// Note that the following function is not
-// called case because case is a keyword in C/C++
-struct caseNode* cas()
+// A name on an alias cycle, see resolve_type_aliases()
+struct alias_member
 {
-    // TODO: implement this for EC
-    return NULL;
-}
+    int group; // position of the cycle's first declared name
+    int index; // position of the name in the TYPE section
+    int line;
+    symbol sym;
+};
 
-struct case_listNode* case_list()
+// What the declaration checks have seen and noted so far
+struct decl_state
 {
-    // TODO: implement this for EC
-    return NULL;
-}
+    int type_count; // names declared in the TYPE section
+    int var_count;  // names declared in the VAR section
+    int use_count;  // var_decls
+    struct decl_reports dup_types;        // code 0
+    struct decl_report type_var_by_type;  // code 1, earliest in type order
+    struct decl_report type_var_by_var;   // code 1, earliest in variable order
+    struct decl_reports dup_vars;         // code 2
+    struct decl_report var_type_by_var;   // code 4, earliest in variable order
+    struct decl_report var_type_by_use;   // code 4, earliest in var_decl order
+    struct alias_member* cycle;           // names on alias cycles
+    int cycle_count;
+    int cycle_capacity;
+    int body_use_count;                   // variable uses in the body
+    struct decl_report type_as_var;       // code 3, earliest in use order
+};
 
-struct switch_stmtNode* switch_stmt()
-{
-    // TODO: implement this for EC
-    return NULL;
-}
+/* -------------------- TOKEN STREAM -------------------- */
 
-struct while_stmtNode* do_stmt()
+/*
+ * tokenize() lexes the input into parallel arrays, one entry per token,
+ * ending with an END_OF_FILE token: a mapped input all of it up front, a
+ * streamed one in batches as the parser gets to them. The parser reads
+ * them through a cursor:
+ *   peek(k)     type of the k-th token after the cursor (0 = next token)
+ *   getToken()  type of the next token, and moves the cursor past it
+ *   tok_rewind(i) moves the cursor to token i, one already looked at;
+ *               error recovery resumes from the furthest one
+ * Looking ahead any number of tokens is free; nothing is lexed twice.
+ * When lexing in batches the tokens before the last one taken are dropped
+ * before each batch, see drop_taken_tokens(), so the arrays hold about one
+ * batch however long the input is. Indices into them are therefore only
+ * good until more tokens are lexed.
+ * Offsets are byte positions in the input. The parser never needs the
+ * token text: an ID token carries its symbol and a NUM or REALNUM token
+ * its value.
+ */
+struct token_stream
 {
-    struct while_stmtNode* doStatement;
-
-    t_type = getToken();
-
-    if (t_type == DO) {
-
-        doStatement = ALLOC(struct while_stmtNode);
-
-        doStatement->body = body();
-
-        //printf("Body assigned\n");
-
-        t_type = getToken();
-
-        if (t_type == WHILE) {
+    signed char* type;  // token_type
+    uint32_t* offset;   // start of the token in the input
+    uint32_t* length;
+    uint32_t* value;    // ID: symbol, NUM: value, REALNUM: float bits
+    int* line;
+    int count;
+    int capacity;
+    int cursor;         // index of the next token, may be count when lexing
+    int furthest;       // furthest token the parser has looked at
+};
 
-            t_type = getToken();
+// Symbols still to be parsed, the tree nodes built so far and the
+// pending operators of the expression being parsed, see program()
+struct parse_stack
+{
+    bool building; // false once a syntax error was recovered from
+    const struct grammar_item** item;
+    int count;
+    int capacity;
+    void** value;
+    int value_count;
+    int value_capacity;
+    int* op;
+    int op_count;
+    int op_capacity;
+};
 
-            doStatement->condition = condition();
+/* -------------------- CHECKER CONTEXT -------------------- */
 
-            // t_type = getToken();
-        }
-    }
+/*
+ * Everything one check works on (see checker.h). Contexts share only the
+ * read-only scanner and parse tables, so threads can each check programs
+ * with a context of their own. Buffers are kept between checks.
+ */
+struct checker
+{
+    struct checker_options options;
+    checker_diag_fn diag;
+    void* diag_user;
+
+    const char *input;  // the buffer or mapping, NULL when streaming
+    size_t input_length;
+    int input_fd;       // descriptor to stream from, -1 for none
+    bool input_mapped;  // input is a mapping made by open_input()
+
+    struct arena tree_arena; // the pointer tree, released once it is flattened
+    struct arena name_arena; // the text of the names
+    struct interner names;
+    struct token_stream tokens;
+    struct lexer lexer; // when lexing on demand, see start_lexing()
+    bool lexing;        // more tokens can be lexed on demand
+    token_type t_type;  // type of the token last taken by the parser
+    struct parse_stack parse;
+    struct flat_tree flat;
+    struct symbol_table symbols;
+    struct decl_state decls;
+    struct type_classes types;
+
+    int syntax_error_count;
+    jmp_buf syntax_recovery; // set by program()
+    jmp_buf check_abort;     // set by run_check(), ends the check
+    int abort_status;        // status the check ended with, see abort_check()
+    int error_found;
+};
 
-    return doStatement;
+// Ends the check with status; run_check() returns it
+static void abort_check(struct checker* ctx, int status)
+{
+    ctx->abort_status = status;
+    longjmp(ctx->check_abort, 1);
 }
 
-struct primaryNode* primary()
+static const char* sym_name(struct checker* ctx, symbol sym)
 {
-    struct primaryNode* prmryNode;
-
-    prmryNode = ALLOC(struct primaryNode);
-
-    t_type = getToken();
-
-    if (t_type == NUM) {
-
-        prmryNode->tag = NUM;
-        prmryNode->ival = atoi(token);
-        prmryNode->fval = 0;
-        prmryNode->id = NULL;
-    }
-
-    else if (t_type == REALNUM) {
-
-        prmryNode->tag = REALNUM;
-        prmryNode->ival = 0;
-        prmryNode->fval = atof(token);
-        prmryNode->id = NULL;
-    }
-
-    else if (t_type == ID) {
-
-        prmryNode->tag = ID;
-        prmryNode->ival = 0;
-        prmryNode->fval = 0;
-        prmryNode->id = strdup(token);
-    }
-
-    return prmryNode;
+    return ctx->names.name[sym];
 }
 
-struct conditionNode* condition()
+// Returns -1 with errno set when the file cannot be opened
+static int open_input(struct checker* ctx, const char *path)
 {
-    struct conditionNode* condNde;
-
-    if (t_type == NUM || t_type == ID || t_type == REALNUM) {
-
-        condNde = ALLOC(struct conditionNode);
-
-        if (condNde->left_operand == NULL) {
-
-            ungetToken();
-            condNde->left_operand = primary();
-            t_type = getToken();
-
-            if (t_type == GREATER || t_type == GTEQ || t_type == LESS || t_type == NOTEQUAL || t_type == LTEQ) {
-                condNde->relop = t_type;
-                t_type = getToken();
-
-                if (t_type == NUM || t_type == ID || t_type == REALNUM) {
-
-                    ungetToken();
-                    condNde->right_operand = primary();
-                    t_type = getToken();
-                }
-            }
-        }
-        
-        else {
+    struct stat st;
+    int fd;
 
-            condNde->right_operand = NULL;
+    fd = STDIN_FILENO;
+    if (path != NULL)
+    {
+        fd = open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            return -1;
         }
     }
-
-
-
-    return condNde;
-}
-
-struct while_stmtNode* while_stmt()
-{
-    //Get the struct for the while statement
-    struct while_stmtNode* whileStmt;
-
-    //Analyze the next token
-    t_type = getToken();
-
-    //If the next token is a WHILE statement, then allocate memory for the size of the while node struct
-    if (t_type == WHILE)
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
     {
-        //Allocate proper memory
-        whileStmt = ALLOC(struct while_stmtNode);
-
-        t_type = getToken();
-
-        //Set the condition portion of the while statement 
-        whileStmt->condition = condition();
-
-        if (t_type == LBRACE) {
-
-            ungetToken();
-
-            whileStmt->body = body();
-
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+        {
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            ctx->input = map;
+            ctx->input_length = st.st_size;
+            ctx->input_fd = -1;
+            ctx->input_mapped = true;
+            if (fd != STDIN_FILENO)
+            {
+                close(fd);
+            }
+            return 0;
         }
     }
 
-    return whileStmt;
+    // Not mappable: stream it
+    ctx->input = NULL;
+    ctx->input_length = 0;
+    ctx->input_fd = fd;
+    ctx->input_mapped = false;
+    return 0;
 }
 
-struct exprNode* factor()
+static void close_input(struct checker* ctx)
 {
-    struct exprNode* facto;
-    
-    t_type = getToken();
-    if (t_type == LPAREN)
+    if (ctx->input_mapped)
     {
-        facto = expr();
-        t_type = getToken();
-        if (t_type == RPAREN)
-        {
-            return facto;
-        }
-        else
-        {
-            syntax_error("factor. RPAREN expected");
-        }
-    }
-    else if (t_type == NUM)
-    {
-        facto = ALLOC(struct exprNode);
-        facto->primary = ALLOC(struct primaryNode);
-        facto->tag = PRIMARY;
-        facto->op = NOOP;
-        facto->leftOperand = NULL;
-        facto->rightOperand = NULL;
-        facto->primary->tag = NUM;
-        facto->primary->ival = atoi(token);
-        return facto;
+        munmap((void *) ctx->input, ctx->input_length);
     }
-    else if (t_type == REALNUM)
+    else if (ctx->input_fd > STDIN_FILENO)
     {
-        facto = ALLOC(struct exprNode);
-        facto->primary = ALLOC(struct primaryNode);
-        facto->tag = PRIMARY;
-        facto->op = NOOP;
-        facto->leftOperand = NULL;
-        facto->rightOperand = NULL;
-        facto->primary->tag = REALNUM;
-        facto->primary->fval = atof(token);
-        return facto;
+        close(ctx->input_fd);
     }
-    else if (t_type == ID)
+    ctx->input = NULL;
+    ctx->input_length = 0;
+    ctx->input_fd = -1;
+    ctx->input_mapped = false;
+}
+
+static void syntax_error(struct checker* ctx, const char* msg);
+
+// Inputs smaller than this per thread are not worth splitting
+#define MIN_CHUNK_SIZE (1 << 20)
+#define MAX_LEX_THREADS 64
+// Tokens lexed at a time when lexing on demand
+#define LEX_BATCH 4096
+
+static void grow_tokens(struct token_stream* ts, int needed)
+{
+    if (needed <= ts->capacity)
     {
-        facto = ALLOC(struct exprNode);
-        facto->primary = ALLOC(struct primaryNode);
-        facto->tag = PRIMARY;
-        facto->op = NOOP;
-        facto->leftOperand = NULL;
-        facto->rightOperand = NULL;
-        facto->primary->tag = ID;
-        facto->primary->id = strdup(token);
-        return facto;
+        return;
     }
-    else
+    ts->capacity = ts->capacity ? 2 * ts->capacity : 1024;
+    if (ts->capacity < needed)
     {
-        syntax_error("factor. NUM, REALNUM, or ID, expected");
+        ts->capacity = needed;
     }
-    return NULL; // control never reaches here, this is just for the sake of GCC
+    ts->type = realloc(ts->type, ts->capacity * sizeof(*ts->type));
+    ts->offset = realloc(ts->offset, ts->capacity * sizeof(*ts->offset));
+    ts->length = realloc(ts->length, ts->capacity * sizeof(*ts->length));
+    ts->value = realloc(ts->value, ts->capacity * sizeof(*ts->value));
+    ts->line = realloc(ts->line, ts->capacity * sizeof(*ts->line));
 }
 
-struct exprNode* term()
+/*
+ * Appends up to max_tokens tokens of lx's range to ts and tells whether
+ * the range ended; END_OF_FILE is not appended. IDs are interned right
+ * away when an interner is given, otherwise their value is left as the
+ * name hash for intern_tokens().
+ */
+static bool tokenize_range(struct lexer* lx, struct token_stream* ts, struct interner* in, int max_tokens)
 {
-    struct exprNode* ter;
-    struct exprNode* f;
-    
-    t_type = getToken();
-    if (t_type == ID || t_type == LPAREN || t_type == NUM || t_type == REALNUM)
+    token_type type;
+    int i;
+
+    for (; max_tokens > 0; max_tokens--)
     {
-        ungetToken();
-        f = factor();
-        t_type = getToken();
-        if (t_type == MULT || t_type == DIV)
+        type = scan_token(lx);
+        if (type == END_OF_FILE)
+        {
+            return true;
+        }
+        grow_tokens(ts, ts->count + 1);
+        i = ts->count++;
+        ts->type[i] = type;
+        ts->offset[i] = lx->base + lx->token_start;
+        ts->length[i] = lx->tokenLength;
+        if (type == ID && in != NULL)
         {
-            ter = ALLOC(struct exprNode);
-            ter->op = t_type;
-            ter->leftOperand = f;
-            ter->rightOperand = term();
-            ter->tag = EXPR;
-            ter->primary = NULL;
-            return ter;
+            ts->value[i] = intern(in, lx->buf + lx->token_start, lx->tokenLength, lx->value);
         }
-        else if (t_type == SEMICOLON || t_type == PLUS ||
-                 t_type == MINUS || t_type == RPAREN)
+        else if (type == ID || type == NUM || type == REALNUM)
         {
-            ungetToken();
-            return f;
+            ts->value[i] = lx->value;
         }
         else
         {
-            syntax_error("term. MULT or DIV expected");
+            ts->value[i] = 0;
         }
+        ts->line[i] = lx->line_no;
     }
-    else
-    {
-        syntax_error("term. ID, LPAREN, NUM, or REALNUM expected");
-    }
-    assert(false);
-    return NULL; // control never reaches here, this is just for the sake of GCC
+    return false;
 }
 
-struct exprNode* expr()
+struct lex_chunk
 {
-    struct exprNode* exp;
-    struct exprNode* t;
-    
-    t_type = getToken();
-    if (t_type == ID || t_type == LPAREN || t_type == NUM || t_type == REALNUM)
-    {
-        ungetToken();
-        t = term();
-        t_type = getToken();
-        if (t_type == PLUS || t_type == MINUS)
-        {
-            exp = ALLOC(struct exprNode);
-            exp->op = t_type;
-            exp->leftOperand = t;
-            exp->rightOperand = expr();
-            exp->tag = EXPR;
-            exp->primary = NULL;
-            return exp;
-        }
-        else if (t_type == SEMICOLON || t_type == MULT ||
-                 t_type == DIV || t_type == RPAREN)
-        {
-            ungetToken();
-            return t;
-        }
-        else
+    struct lexer lx;
+    struct token_stream ts;
+    struct interner* names; // NULL on worker threads
+};
+
+static void* lex_chunk_thread(void* arg)
+{
+    struct lex_chunk* chunk = arg;
+
+    tokenize_range(&chunk->lx, &chunk->ts, chunk->names, INT32_MAX);
+    return NULL;
+}
+
+// Replaces the name hashes left by parallel lexing with symbols
+static void intern_tokens(struct checker* ctx, int first, int count)
+{
+    int i;
+
+    for (i = first; i < first + count; i++)
+    {
+        if (ctx->tokens.type[i] == ID)
         {
-            syntax_error("expr. PLUS, MINUS, or SEMICOLON expected");
+            ctx->tokens.value[i] = intern(&ctx->names, ctx->input + ctx->tokens.offset[i],
+                                          ctx->tokens.length[i], ctx->tokens.value[i]);
         }
     }
+}
+
+/*
+ * Sets up one lexer on the whole input that lexes tokens as the parser
+ * asks for them, see lex_more(). This is how a streamed input is read, so
+ * that its tokens need not all be kept, and how any input is read when
+ * the check stops at its first error, so that nothing after that error is
+ * lexed.
+ */
+static void start_lexing(struct checker* ctx)
+{
+    struct lexer* lx = &ctx->lexer;
+
+    memset(lx, 0, sizeof(*lx));
+    if (ctx->input_fd >= 0)
+    {
+        lx->block_size = INPUT_BLOCK_SIZE;
+        lx->block = malloc(lx->block_size);
+        lx->buf = lx->block;
+        lx->fd = ctx->input_fd;
+    }
     else
     {
-        syntax_error("expr. ID, LPAREN, NUM, or REALNUM expected");
+        lx->buf = ctx->input;
+        lx->end = ctx->input_length;
+        lx->fd = -1;
     }
-    assert(false);
-    return NULL; // control never reaches here, this is just for the sake of GCC
+    lx->line_no = 1;
+    ctx->tokens.count = 0;
+    ctx->tokens.cursor = 0;
+    ctx->tokens.furthest = 0;
+    ctx->lexing = true;
+}
+
+/*
+ * Drops the tokens before the last one taken by getToken(), which the
+ * parser never looks at again, and moves the indices down to match. Error
+ * recovery only goes back as far as the furthest token looked at, which
+ * is never before the last one taken.
+ */
+static void drop_taken_tokens(struct token_stream* ts)
+{
+    int drop = ts->cursor - 1;
+    int keep;
+
+    if (drop <= 0)
+    {
+        return;
+    }
+    keep = ts->count - drop;
+    memmove(ts->type, ts->type + drop, keep * sizeof(*ts->type));
+    memmove(ts->offset, ts->offset + drop, keep * sizeof(*ts->offset));
+    memmove(ts->length, ts->length + drop, keep * sizeof(*ts->length));
+    memmove(ts->value, ts->value + drop, keep * sizeof(*ts->value));
+    memmove(ts->line, ts->line + drop, keep * sizeof(*ts->line));
+    ts->count = keep;
+    ts->cursor -= drop;
+    ts->furthest -= drop;
 }
 
-struct assign_stmtNode* assign_stmt()
+// Lexes until the token ahead positions after the cursor exists or the
+// END_OF_FILE token is added
+static void lex_more(struct checker* ctx, int ahead)
 {
-    struct assign_stmtNode* assignStmt;
-    
-    t_type = getToken();
-    if (t_type == ID)
+    struct lexer* lx = &ctx->lexer;
+    int i;
+
+    while (ctx->lexing && ctx->tokens.cursor + ahead >= ctx->tokens.count)
     {
-        assignStmt = ALLOC(struct assign_stmtNode);
-        assignStmt->id = strdup(token);
-        assignStmt->lineNumberTracker = line_no;
-        t_type = getToken();
-        if (t_type == EQUAL)
+        drop_taken_tokens(&ctx->tokens);
+        if (!tokenize_range(lx, &ctx->tokens, &ctx->names, LEX_BATCH))
         {
-            assignStmt->expr = expr();
-            t_type = getToken();
-            if (t_type == SEMICOLON)
-            {
-                return assignStmt;
-            }
-            else
-            {
-                syntax_error("asign_stmt. SEMICOLON expected");
-            }
+            continue;
         }
-        else
+        free(lx->block);
+        lx->block = NULL;
+        ctx->lexing = false;
+        if (lx->read_errno != 0)
         {
-            syntax_error("assign_stmt. EQUAL expected");
+            errno = lx->read_errno;
+            abort_check(ctx, CHECK_IO_ERROR);
         }
+
+        grow_tokens(&ctx->tokens, ctx->tokens.count + 1);
+        i = ctx->tokens.count++;
+        ctx->tokens.type[i] = END_OF_FILE;
+        ctx->tokens.offset[i] = lx->base + lx->pos;
+        ctx->tokens.length[i] = 0;
+        ctx->tokens.value[i] = 0;
+        ctx->tokens.line[i] = lx->line_no;
     }
-    else
-    {
-        syntax_error("assign_stmt. ID expected");
-    }
-    assert(false);
-    return NULL; // control never reaches here, this is just for the sake of GCC
 }
 
-struct stmtNode* stmt()
+/*
+ * Splits the input into chunks that start on whitespace, so that no token
+ * crosses a chunk boundary, and lexes them on separate threads. Each chunk
+ * counts lines from 0; the chunk line counts are then prefix summed to fix
+ * up the line numbers while the chunk arrays are copied into ctx->tokens. The
+ * result is the same token stream a single lexer would produce.
+ * A streamed input is lexed by one lexer as it is read, a batch at a time
+ * as the parser needs it. Only its tokens are bounded that way: the parse
+ * tree and the interned names still grow with the program.
+ */
+static void tokenize(struct checker* ctx)
 {
-    struct stmtNode* stm;
-    
-    stm = ALLOC(struct stmtNode);
-    t_type = getToken();
-    if (t_type == ID) // assign_stmt
+    struct lex_chunk chunks[MAX_LEX_THREADS];
+    pthread_t threads[MAX_LEX_THREADS];
+    int n, c, i, line_base, total;
+    size_t start, cut;
+
+    if (ctx->input_length > UINT32_MAX)
     {
-        ungetToken();
-        stm->assign_stmt = assign_stmt();
-        stm->stmtType = ASSIGN;
+        // Token offsets are 32-bit
+        errno = EFBIG;
+        abort_check(ctx, CHECK_IO_ERROR);
     }
-    else if (t_type == WHILE) // while_stmt
+    if (ctx->input_fd >= 0 || ctx->options.stop_at_first_error)
     {
-        ungetToken();
-        stm->while_stmt = while_stmt();
-        stm->stmtType = WHILE;
+        start_lexing(ctx);
+        return;
     }
-    else if (t_type == DO)  // do_stmt
+    n = ctx->options.lex_threads > 0 ? ctx->options.lex_threads : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if ((size_t) n > ctx->input_length / MIN_CHUNK_SIZE)
     {
-        ungetToken();
-        stm->while_stmt = do_stmt();
-        stm->stmtType = DO;
+        n = ctx->input_length / MIN_CHUNK_SIZE;
     }
-    else if (t_type == SWITCH) // switch_stmt
+    if (n > MAX_LEX_THREADS)
     {
-        ungetToken();
-        stm->switch_stmt = switch_stmt();
-        stm->stmtType = SWITCH;
+        n = MAX_LEX_THREADS;
     }
-    else
+    if (n < 1)
     {
-        syntax_error("stmt. ID, WHILE, DO or SWITCH expected");
+        n = 1;
     }
-    return stm;
-}
 
-struct stmt_listNode* stmt_list()
-{
-    struct stmt_listNode* stmtList;
-    
-    t_type = getToken();
-    if (t_type == ID || t_type == WHILE ||
-        t_type == DO || t_type == SWITCH)
+    memset(chunks, 0, sizeof(chunks));
+    start = 0;
+    for (c = 0; c < n; c++)
     {
-        ungetToken();
-        stmtList = ALLOC(struct stmt_listNode);
-        stmtList->stmt = stmt();
-        t_type = getToken();
-        if (t_type == ID || t_type == WHILE ||
-            t_type == DO || t_type == SWITCH)
+        cut = c == n - 1 ? ctx->input_length : ctx->input_length / n * (c + 1);
+        if (cut < start)
         {
-            ungetToken();
-            stmtList->stmt_list = stmt_list();
-            return stmtList;
+            cut = start;
         }
-        else // If the next token is not in FOLLOW(stmt_list),
-            // let the caller handle it.
+        while (cut < ctx->input_length && !is_space_char(ctx->input[cut]))
         {
-            ungetToken();
-            stmtList->stmt_list = NULL;
-            return stmtList;
+            cut++;
         }
+        chunks[c].lx.buf = ctx->input;
+        chunks[c].lx.pos = start;
+        chunks[c].lx.end = cut;
+        chunks[c].lx.line_no = 0;
+        chunks[c].lx.fd = -1;
+        chunks[c].names = n == 1 ? &ctx->names : NULL;
+        start = cut;
     }
-    else
-    {
-        syntax_error("stmt_list. ID, WHILE, DO or SWITCH expected");
-    }
-    assert(false);
-    return NULL; // control never reaches here, this is just for the sake of GCC
-}
 
-struct bodyNode* body()
-{
-    struct bodyNode* bod;
-    
-    t_type = getToken();
-    if (t_type == LBRACE)
+    // The first chunk is lexed on this thread
+    for (c = 1; c < n; c++)
     {
-        bod = ALLOC(struct bodyNode);
-        bod->stmt_list = stmt_list();
-        t_type = getToken();
-        if (t_type == RBRACE)
+        if (pthread_create(&threads[c], NULL, lex_chunk_thread, &chunks[c]) != 0)
         {
-            return bod;
+            lex_chunk_thread(&chunks[c]);
+            threads[c] = 0;
         }
-        else
+    }
+    lex_chunk_thread(&chunks[0]);
+    for (c = 1; c < n; c++)
+    {
+        if (threads[c] != 0)
         {
-            syntax_error("body. RBRACE expected");
+            pthread_join(threads[c], NULL);
         }
     }
-    else
+
+    if (n == 1)
     {
-        syntax_error("body. LBRACE expected");
+        ctx->tokens = chunks[0].ts;
     }
-    assert(false);
-    return NULL; // control never reaches here, this is just for the sake of GCC
-}
-
-struct type_nameNode* type_name()
-{
-    struct type_nameNode* tName;
-    
-    tName = ALLOC(struct type_nameNode);
-    t_type = getToken();
-    if (t_type == ID || t_type == INT || t_type == REAL ||
-        t_type == STRING || t_type == BOOLEAN || t_type == LONG)
+    else
     {
-        tName->type = t_type;
-        if (t_type == ID)
-        {
-
-            tName->id = strdup(token);
-        }
-        else
+        total = 0;
+        for (c = 0; c < n; c++)
         {
-            tName->id = NULL;
+            total += chunks[c].ts.count;
         }
-        return tName;
+        grow_tokens(&ctx->tokens, total + 1);
     }
-    else
+    line_base = 1;
+    total = 0;
+    for (c = 0; c < n; c++)
     {
-        syntax_error("type_name. type name expected");
-    }
-    assert(false);
-    return NULL; // control never reaches here, this is just for the sake of GCC
-}
+        struct token_stream* ts = &chunks[c].ts;
 
-struct id_listNode* id_list()
-{
-    struct id_listNode* idList;
-    
-    idList = ALLOC(struct id_listNode);
-    t_type = getToken();
-    if (t_type == ID)
-    {
-        idList->id = strdup(token);
-        t_type = getToken();
-        if (t_type == COMMA)
+        if (n > 1)
         {
-            idList->id_list = id_list();
-            return idList;
+            memcpy(ctx->tokens.type + total, ts->type, ts->count * sizeof(*ts->type));
+            memcpy(ctx->tokens.offset + total, ts->offset, ts->count * sizeof(*ts->offset));
+            memcpy(ctx->tokens.length + total, ts->length, ts->count * sizeof(*ts->length));
+            memcpy(ctx->tokens.value + total, ts->value, ts->count * sizeof(*ts->value));
+            intern_tokens(ctx, total, ts->count);
         }
-        else if (t_type == COLON)
+        for (i = 0; i < ts->count; i++)
         {
-            ungetToken();
-            idList->id_list = NULL;
-            return idList;
+            ctx->tokens.line[total + i] = ts->line[i] + line_base;
         }
-        else
+        total += ts->count;
+        line_base += chunks[c].lx.line_no;
+        if (n > 1)
         {
-            syntax_error("id_list. COMMA or COLON expected");
+            free(ts->type);
+            free(ts->offset);
+            free(ts->length);
+            free(ts->value);
+            free(ts->line);
         }
     }
-    else
-    {
-        syntax_error("id_list. ID expected");
-    }
-    assert(false);
-    return NULL; // control never reaches here, this is just for the sake of GCC
+
+    grow_tokens(&ctx->tokens, total + 1);
+    ctx->tokens.type[total] = END_OF_FILE;
+    ctx->tokens.offset[total] = ctx->input_length;
+    ctx->tokens.length[total] = 0;
+    ctx->tokens.value[total] = 0;
+    ctx->tokens.line[total] = line_base;
+    ctx->tokens.count = total + 1;
+    ctx->tokens.cursor = 0;
+    ctx->tokens.furthest = 0;
+}
+
+static void free_tokens(struct checker* ctx)
+{
+    free(ctx->lexer.block);
+    ctx->lexer.block = NULL;
+    ctx->lexing = false;
+    free(ctx->tokens.type);
+    free(ctx->tokens.offset);
+    free(ctx->tokens.length);
+    free(ctx->tokens.value);
+    free(ctx->tokens.line);
+    memset(&ctx->tokens, 0, sizeof(ctx->tokens));
 }
 
-struct type_declNode* type_decl()
+// Index of the k-th token after the cursor; the END_OF_FILE token repeats
+static inline int token_index(struct checker* ctx, int k)
 {
-    struct type_declNode* typeDecl;
-    
-    typeDecl = ALLOC(struct type_declNode);
-    t_type = getToken();
-    if (t_type == ID)
+    int i;
+
+    if (ctx->tokens.cursor + k >= ctx->tokens.count)
     {
-        ungetToken();
-        typeDecl->id_list = id_list();
-        t_type = getToken();
-        if (t_type == COLON)
-        {
-            typeDecl->type_name = type_name();
-            t_type = getToken();
-            if (t_type == SEMICOLON)
-            {
-                return typeDecl;
-            }
-            else
-            {
-                syntax_error("type_decl. SEMICOLON expected");
-            }
-        }
-        else
-        {
-            syntax_error("type_decl. COLON expected");
-        }
+        // May drop taken tokens, which moves the cursor
+        lex_more(ctx, k);
     }
-    else
+    i = ctx->tokens.cursor + k;
+    if (i >= ctx->tokens.count)
+    {
+        i = ctx->tokens.count - 1;
+    }
+    if (i > ctx->tokens.furthest)
     {
-        syntax_error("type_decl. ID expected");
+        ctx->tokens.furthest = i;
     }
-    assert(false);
-    return NULL; // control never reaches here, this is just for the sake of GCC
+    return i;
+}
+
+static token_type peek(struct checker* ctx, int k)
+{
+    // The index first: finding it may lex more tokens and move the arrays
+    int i = token_index(ctx, k);
+
+    return (token_type) ctx->tokens.type[i];
 }
 
-struct var_declNode* var_decl()
+static token_type getToken(struct checker* ctx)
 {
-    struct var_declNode* varDecl;
+    int i = token_index(ctx, 0);
+    token_type t = (token_type) ctx->tokens.type[i];
 
-    //VERBOSE
-    // switched_to_var = 1;
-    
-    varDecl = ALLOC(struct var_declNode);
-    t_type = getToken();
-    if (t_type == ID)
+    // The cursor stays on the END_OF_FILE token
+    if (t != END_OF_FILE)
     {
-        ungetToken();
-        varDecl->id_list = id_list();
-        t_type = getToken();
-        if (t_type == COLON)
-        {
-            varDecl->type_name = type_name();
-            t_type = getToken();
-            if (t_type == SEMICOLON)
+        ctx->tokens.cursor = i + 1;
+    }
+    return t;
+}
+
+static void tok_rewind(struct checker* ctx, int mark)
+{
+    ctx->tokens.cursor = mark;
+}
+
+/*
+ * Line, symbol and value of the token last taken by getToken()
+ */
+static inline int last_token(struct checker* ctx)
+{
+    return ctx->tokens.cursor > 0 ? ctx->tokens.cursor - 1 : 0;
+}
+
+static int token_line(struct checker* ctx)
+{
+    return ctx->tokens.line[last_token(ctx)];
+}
+
+static symbol token_symbol(struct checker* ctx)
+{
+    return ctx->tokens.value[last_token(ctx)];
+}
+
+static int token_int(struct checker* ctx)
+{
+    uint32_t value = ctx->tokens.value[last_token(ctx)];
+
+    if (value == NUM_OVERFLOW)
+    {
+        syntax_error(ctx, "NUM. integer constant too large");
+    }
+    return (int) value;
+}
+
+static float token_float(struct checker* ctx)
+{
+    uint32_t bits = ctx->tokens.value[last_token(ctx)];
+    float value;
+
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/* ----------------------------------------------------------------- */
+/* -------------------- SYNTAX ANALYSIS SECTION -------------------- */
+/* ----------------------------------------------------------------- */
+
+// Formats one diagnostic and hands it to the context's callback
+static void report(struct checker* ctx, const char* format, ...)
+{
+    char small[256];
+    char* text = small;
+    va_list args;
+    int n;
+
+    va_start(args, format);
+    n = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+    if (n >= (int) sizeof(small))
+    {
+        text = malloc(n + 1);
+        va_start(args, format);
+        vsnprintf(text, n + 1, format, args);
+        va_end(args);
+    }
+    if (ctx->diag != NULL)
+    {
+        ctx->diag(ctx->diag_user, text);
+    }
+    if (text != small)
+    {
+        free(text);
+    }
+}
+
+// With recovery on the parser resumes after a syntax error and keeps
+// reporting, up to options.max_syntax_errors of them
+static void syntax_error(struct checker* ctx, const char* msg)
+{
+    report(ctx, "Syntax error while parsing %s line %d\n", msg, ctx->tokens.line[ctx->tokens.furthest]);
+    ctx->syntax_error_count++;
+    if (!ctx->options.recover_syntax_errors ||
+        ctx->syntax_error_count >= ctx->options.max_syntax_errors)
+    {
+        abort_check(ctx, CHECK_SYNTAX_ERROR);
+    }
+    longjmp(ctx->syntax_recovery, 1);
+}
+
+/* -------------------- DECLARATION CHECKS -------------------- */
+
+/*
+ * Error codes 0, 1, 2 and 4 are found while the declarations are parsed:
+ * each name goes into the symbol table as its declaration is reduced, and
+ * an error is noted as soon as the table shows it. Error code 3 is found
+ * as the body is parsed. They are reported by priority and in the order
+ * the codes always used:
+ *   0  every declaration of a type name but its last one
+ *   1  the first name declared both as a type and as a variable, in the
+ *      order of the longer of the two lists (the types when equal)
+ *   2  every declaration of a variable but its last one
+ *   3  the first type name used as a variable in the body
+ *   4  the first variable also used as a type name, in the order of the
+ *      longer of the variable list and the var_decl list (the variables
+ *      when equal)
+ * and after them the alias cycles found by resolve_type_aliases() at the
+ * end of the declarations. report_declaration_errors() reports codes 0 to
+ * 2, report_variable_uses() code 3 and report_type_name_errors() the rest.
+ */
+
+// Enters one declared name in the symbol table; line and type are those
+// of its first declaration
+static struct symbol_entry* declare_symbol(struct checker* ctx, symbol sym, int kind,
+                                           int line, int type, symbol type_id)
+{
+    struct symbol_entry* entry = symbol_insert(&ctx->symbols, sym);
+
+    if (entry->kind == 0)
+    {
+        entry->line = line;
+        entry->type = type;
+        entry->type_id = type_id;
+    }
+    entry->kind |= kind;
+    return entry;
+}
+
+static void note_duplicate(struct decl_reports* r, int index, symbol sym)
+{
+    if (r->count == r->capacity)
+    {
+        r->capacity = r->capacity ? 2 * r->capacity : 16;
+        r->report = realloc(r->report, r->capacity * sizeof(*r->report));
+    }
+    r->report[r->count].index = index;
+    r->report[r->count].sym = sym;
+    r->count++;
+}
+
+static inline void note_earliest(struct decl_report* r, int index, symbol sym)
+{
+    if (r->index < 0 || index < r->index)
+    {
+        r->index = index;
+        r->sym = sym;
+    }
+}
+
+static int compare_reports(const void* a, const void* b)
+{
+    return ((const struct decl_report*) a)->index - ((const struct decl_report*) b)->index;
+}
+
+static void reset_decl_state(struct decl_state* ds)
+{
+    ds->type_count = 0;
+    ds->var_count = 0;
+    ds->use_count = 0;
+    ds->dup_types.count = 0;
+    ds->dup_vars.count = 0;
+    ds->type_var_by_type.index = -1;
+    ds->type_var_by_var.index = -1;
+    ds->var_type_by_var.index = -1;
+    ds->var_type_by_use.index = -1;
+    ds->cycle_count = 0;
+    ds->body_use_count = 0;
+    ds->type_as_var.index = -1;
+}
+
+static void free_decl_state(struct decl_state* ds)
+{
+    free(ds->dup_types.report);
+    free(ds->dup_vars.report);
+    free(ds->cycle);
+    memset(ds, 0, sizeof(*ds));
+}
+
+// Union-find node of a type name: a built in type or a named one
+static uint32_t type_node(struct checker* ctx, int type, symbol type_id)
+{
+    struct symbol_entry* entry;
+    uint32_t node;
+
+    switch (type)
+    {
+        case INT:     node = 0; break;
+        case REAL:    node = 1; break;
+        case STRING:  node = 2; break;
+        case BOOLEAN: node = 3; break;
+        case LONG:    node = 4; break;
+        default:
+            // The insert can move the table, so read its start after it
+            entry = symbol_insert(&ctx->symbols, type_id);
+            node = BUILTIN_TYPES + (entry - ctx->symbols.entry);
+            break;
+    }
+    make_type_nodes(&ctx->types, node);
+    return node;
+}
+
+// A declaration makes the declared name, entry e, the same type as the
+// type it is declared with
+static void declare_type_of(struct checker* ctx, uint32_t e, int type, symbol type_id)
+{
+    uint32_t node = BUILTIN_TYPES + e;
+
+    make_type_nodes(&ctx->types, node);
+    unite_types(&ctx->types, node, type_node(ctx, type, type_id));
+}
+
+// One name of the TYPE section
+static void declare_type_name(struct checker* ctx, symbol sym, int line, int type, symbol type_id)
+{
+    struct decl_state* ds = &ctx->decls;
+    struct symbol_entry* entry = declare_symbol(ctx, sym, SYM_TYPE, line, type, type_id);
+
+    if (entry->last_type >= 0)
+    {
+        note_duplicate(&ds->dup_types, entry->last_type, sym);
+    }
+    else
+    {
+        entry->first_type = ds->type_count;
+    }
+    entry->last_type = ds->type_count++;
+    declare_type_of(ctx, entry - ctx->symbols.entry, type, type_id);
+}
+
+// One name of the VAR section; the TYPE section is complete by now
+static void declare_var_name(struct checker* ctx, symbol sym, int line, int type, symbol type_id)
+{
+    struct decl_state* ds = &ctx->decls;
+    struct symbol_entry* entry = declare_symbol(ctx, sym, SYM_VAR, line, type, type_id);
+
+    if (entry->last_var >= 0)
+    {
+        note_duplicate(&ds->dup_vars, entry->last_var, sym);
+    }
+    else
+    {
+        entry->first_var = ds->var_count;
+        if (entry->kind & SYM_TYPE)
+        {
+            note_earliest(&ds->type_var_by_type, entry->first_type, sym);
+            note_earliest(&ds->type_var_by_var, ds->var_count, sym);
+        }
+        if (entry->first_use >= 0)
+        {
+            note_earliest(&ds->var_type_by_var, ds->var_count, sym);
+            note_earliest(&ds->var_type_by_use, entry->first_use, sym);
+        }
+    }
+    entry->last_var = ds->var_count++;
+    declare_type_of(ctx, entry - ctx->symbols.entry, type, type_id);
+}
+
+// The type of one var_decl, after its names
+static void use_type_name(struct checker* ctx, int type, symbol type_id)
+{
+    struct decl_state* ds = &ctx->decls;
+    struct symbol_entry* entry;
+
+    // Built in types have no symbol, they never match a variable
+    if (type == ID)
+    {
+        entry = symbol_insert(&ctx->symbols, type_id);
+        if (entry->first_use < 0)
+        {
+            entry->first_use = ds->use_count;
+            if (entry->first_var >= 0)
+            {
+                note_earliest(&ds->var_type_by_var, entry->first_var, type_id);
+                note_earliest(&ds->var_type_by_use, ds->use_count, type_id);
+            }
+        }
+    }
+    ds->use_count++;
+}
+
+/*
+ * The TYPE declarations form a graph with an edge from each type name to
+ * the type name it is declared as. An iterative Tarjan pass finds its
+ * strongly connected components in O(V+E) without recursion, so alias
+ * chains of any depth are fine. A component of more than one name, or a
+ * name declared as itself, is an alias cycle and is noted for reporting.
+ * The declarations are complete by then, so the root of every declared
+ * name's type class is final and is cached in its entry; the type checks
+ * then find the type of a declared variable with one table lookup.
+ */
+
+// Entry index of the type name that entry e is declared as, -1 for none
+static int alias_target(struct symbol_table* st, uint32_t e)
+{
+    struct symbol_entry* target;
+
+    if (st->entry[e].type != ID)
+    {
+        return -1;
+    }
+    target = symbol_lookup(st, st->entry[e].type_id);
+    if (target == NULL || !(target->kind & SYM_TYPE))
+    {
+        return -1;
+    }
+    return target - st->entry;
+}
+
+static void note_alias_cycle(struct decl_state* ds, int group, struct symbol_entry* entry)
+{
+    struct alias_member* m;
+
+    if (ds->cycle_count == ds->cycle_capacity)
+    {
+        ds->cycle_capacity = ds->cycle_capacity ? 2 * ds->cycle_capacity : 16;
+        ds->cycle = realloc(ds->cycle, ds->cycle_capacity * sizeof(*ds->cycle));
+    }
+    m = &ds->cycle[ds->cycle_count++];
+    m->group = group;
+    m->index = entry->first_type;
+    m->line = entry->line;
+    m->sym = entry->sym;
+}
+
+static void resolve_type_aliases(struct checker* ctx)
+{
+    struct symbol_table* st = &ctx->symbols;
+    int* order;      // visit order, -1 while unvisited
+    int* low;        // lowest visit order reachable, -1 once completed
+    uint32_t* stack; // names of components not yet completed
+    uint32_t* call;  // the path being explored, in place of recursion
+    uint32_t n = st->count, top = 0, depth = 0, e, v, m, k;
+    int w, visits = 0, group;
+
+    order = malloc(n * sizeof(*order));
+    low = malloc(n * sizeof(*low));
+    stack = malloc(n * sizeof(*stack));
+    call = malloc(n * sizeof(*call));
+    for (e = 0; e < n; e++)
+    {
+        order[e] = -1;
+    }
+
+    for (e = 0; e < n; e++)
+    {
+        if (!(st->entry[e].kind & SYM_TYPE) || order[e] >= 0)
+        {
+            continue;
+        }
+        order[e] = low[e] = visits++;
+        stack[top++] = e;
+        call[depth++] = e;
+        while (depth > 0)
+        {
+            v = call[depth - 1];
+            w = alias_target(st, v);
+            if (w >= 0 && order[w] < 0)
+            {
+                // Descend; a name has at most one edge, so v is done with
+                // its edges once w returns
+                order[w] = low[w] = visits++;
+                stack[top++] = w;
+                call[depth++] = w;
+                continue;
+            }
+            if (w >= 0 && low[w] >= 0 && low[w] < low[v])
+            {
+                low[v] = low[w];
+            }
+            depth--;
+            if (low[v] != order[v])
+            {
+                continue;
+            }
+
+            // v roots a component: it is stack[...] down to v
+            for (m = top; stack[m - 1] != v; m--)
+            {
+            }
+            if (top - m > 0 || w == (int) v)
+            {
+                group = st->entry[v].first_type;
+                for (k = m - 1; k < top; k++)
+                {
+                    if (st->entry[stack[k]].first_type < group)
+                    {
+                        group = st->entry[stack[k]].first_type;
+                    }
+                }
+                for (k = m - 1; k < top; k++)
+                {
+                    note_alias_cycle(&ctx->decls, group, &st->entry[stack[k]]);
+                }
+            }
+            for (k = m - 1; k < top; k++)
+            {
+                low[stack[k]] = -1;
+            }
+            top = m - 1;
+        }
+    }
+
+    for (e = 0; e < n && BUILTIN_TYPES + e < ctx->types.count; e++)
+    {
+        st->entry[e].type_class = find_type(&ctx->types, BUILTIN_TYPES + e);
+    }
+
+    free(order);
+    free(low);
+    free(stack);
+    free(call);
+}
+
+static int compare_alias_members(const void* a, const void* b)
+{
+    const struct alias_member* x = a;
+    const struct alias_member* y = b;
+
+    if (x->group != y->group)
+    {
+        return x->group - y->group;
+    }
+    return x->index - y->index;
+}
+
+// Reports each alias cycle on a line of its own, its names in declaration
+// order, with the line of its first declared name
+static void report_alias_cycles(struct checker* ctx)
+{
+    struct decl_state* ds = &ctx->decls;
+    size_t length;
+    char* names;
+    int i, j, k;
+
+    qsort(ds->cycle, ds->cycle_count, sizeof(*ds->cycle), compare_alias_members);
+    for (i = 0; i < ds->cycle_count; i = j)
+    {
+        length = 0;
+        for (j = i; j < ds->cycle_count && ds->cycle[j].group == ds->cycle[i].group; j++)
+        {
+            length += strlen(sym_name(ctx, ds->cycle[j].sym)) + 1;
+        }
+        names = malloc(length + 1);
+        names[0] = '\0';
+        length = 0;
+        for (k = i; k < j; k++)
+        {
+            length += sprintf(names + length, k > i ? " %s" : "%s", sym_name(ctx, ds->cycle[k].sym));
+        }
+        report(ctx, "ALIAS CYCLE %s line %d\n", names, ds->cycle[i].line);
+        free(names);
+    }
+}
+
+// Reports the noted error of codes 0 to 2 of the highest priority, if any
+static void report_declaration_errors(struct checker* ctx)
+{
+    struct decl_state* ds = &ctx->decls;
+    struct decl_report* r;
+    int i;
+
+    //Error Code 0:
+    if (ds->dup_types.count > 0)
+    {
+        qsort(ds->dup_types.report, ds->dup_types.count, sizeof(struct decl_report), compare_reports);
+        for (i = 0; i < ds->dup_types.count; i++)
+        {
+            report(ctx, "ERROR CODE 0 %s\n", sym_name(ctx, ds->dup_types.report[i].sym));
+        }
+        ctx->error_found = 1;
+        return;
+    }
+
+    //Error Code 1:
+    r = ds->type_count >= ds->var_count ? &ds->type_var_by_type : &ds->type_var_by_var;
+    if (r->index >= 0)
+    {
+        report(ctx, "ERROR CODE 1 %s", sym_name(ctx, r->sym));
+        ctx->error_found = 1;
+        return;
+    }
+
+    //Error Code 2:
+    if (ds->dup_vars.count > 0)
+    {
+        qsort(ds->dup_vars.report, ds->dup_vars.count, sizeof(struct decl_report), compare_reports);
+        for (i = 0; i < ds->dup_vars.count; i++)
+        {
+            report(ctx, "ERROR CODE 2 %s", sym_name(ctx, ds->dup_vars.report[i].sym));
+        }
+        ctx->error_found = 1;
+    }
+}
+
+static void report_variable_uses(struct checker* ctx)
+{
+    struct decl_report* r = &ctx->decls.type_as_var;
+
+    //Error Code 3:
+    if (r->index >= 0)
+    {
+        report(ctx, "ERROR CODE 3 %s", sym_name(ctx, r->sym));
+        ctx->error_found = 1;
+    }
+}
+
+// Code 4 and the alias cycles, once the body shows no code 3
+static void report_type_name_errors(struct checker* ctx)
+{
+    struct decl_state* ds = &ctx->decls;
+    struct decl_report* r;
+
+    //Error Code 4:
+    r = ds->var_count >= ds->use_count ? &ds->var_type_by_var : &ds->var_type_by_use;
+    if (r->index >= 0)
+    {
+        report(ctx, "ERROR CODE 4 %s", sym_name(ctx, r->sym));
+        ctx->error_found = 1;
+        return;
+    }
+
+    //Alias cycles:
+    if (ds->cycle_count > 0)
+    {
+        report_alias_cycles(ctx);
+        ctx->error_found = 1;
+    }
+}
+
+/*
+ * A name used as a variable in the body: the left side of an assignment,
+ * a primary or the variable of a switch. Each use is one lookup. A type
+ * name, declared or only used as one, is error code 3; a name not seen
+ * before is declared by its first use, and the type checks give it the
+ * type of that use, see match_types().
+ */
+static void use_variable_name(struct checker* ctx, symbol sym, int line)
+{
+    struct decl_state* ds = &ctx->decls;
+    struct symbol_entry* entry = symbol_lookup(&ctx->symbols, sym);
+
+    if (entry == NULL)
+    {
+        entry = declare_symbol(ctx, sym, SYM_VAR | SYM_IMPLICIT, line, 0, 0);
+        make_type_nodes(&ctx->types, BUILTIN_TYPES + (entry - ctx->symbols.entry));
+    }
+    else if (!(entry->kind & SYM_VAR))
+    {
+        note_earliest(&ds->type_as_var, ds->body_use_count, sym);
+        // Codes 0 to 2 were ruled out at the end of the declarations, and
+        // nothing else outranks it
+        if (ctx->options.stop_at_first_error && ctx->syntax_error_count == 0)
+        {
+            report_variable_uses(ctx);
+            abort_check(ctx, CHECK_SEMANTIC_ERROR);
+        }
+    }
+    ds->body_use_count++;
+}
+
+/*
+ * With options.stop_at_first_error the check ends as soon as the first
+ * error it would report is known, without lexing or parsing the rest.
+ * Code 0 outranks the others, so it is known at the end of the TYPE
+ * section; codes 1 and 2 are known at the end of the declarations, and
+ * code 3 at its first use in the body. A syntax error further on is then
+ * never seen. Code 4 and the alias cycles rank below code 3, so they are
+ * only known once the whole body is parsed.
+ */
+static void stop_at_declaration_errors(struct checker* ctx)
+{
+    report_declaration_errors(ctx);
+    if (ctx->error_found)
+    {
+        abort_check(ctx, CHECK_SEMANTIC_ERROR);
+    }
+}
+
+/* -------------------- PARSING AND BUILDING PARSE TREE -------------------- */
+
+/*
+ * The grammar is written down once, as the productions below, and parsed
+ * by a table-driven LL(1) driver. Each right hand side holds terminals,
+ * nonterminals and actions. Actions build the parse tree on a value stack
+ * as soon as the symbols before them have been parsed. A terminal carries
+ * the syntax error for when the next token does not match it. A
+ * nonterminal's error is in nonterminal_error[]. A nonterminal without one
+ * falls back to its empty production on any token, which leaves the error
+ * to its caller.
+ */
+
+enum nonterminal
+{
+    NT_PROGRAM = 64, NT_DECL, NT_TYPE_DECL_SECTION, NT_VAR_DECL_SECTION_OPT,
+    NT_VAR_DECL_SECTION, NT_TYPE_DECL_LIST, NT_TYPE_DECL_MORE, NT_TYPE_DECL,
+    NT_VAR_DECL_LIST, NT_VAR_DECL_MORE, NT_VAR_DECL, NT_ID_LIST, NT_ID_LIST_MORE,
+    NT_TYPE_NAME, NT_BODY, NT_STMT_LIST, NT_STMT_MORE, NT_STMT, NT_ASSIGN_STMT,
+    NT_WHILE_STMT, NT_DO_STMT, NT_SWITCH_STMT, NT_CASE_LIST, NT_CASE_MORE,
+    NT_CASE, NT_CONDITION, NT_CONDITION_TAIL, NT_PRIMARY, NT_END
+};
+
+#define NT_COUNT (NT_END - NT_PROGRAM)
+
+enum parse_action
+{
+    A_PROGRAM = 128, A_DECL, A_DECL_END, A_TYPE_SECTION, A_VAR_SECTION,
+    A_TYPE_DECL_FIRST, A_TYPE_DECL_NEXT, A_VAR_DECL_FIRST, A_VAR_DECL_NEXT,
+    A_ID_FIRST, A_ID_NEXT, A_STMT_FIRST, A_STMT_NEXT, A_CASE_FIRST, A_CASE_NEXT,
+    A_LIST_END,
+    A_TYPE_DECL, A_VAR_DECL, A_TYPE_NAME, A_BODY,
+    A_STMT_ASSIGN, A_STMT_WHILE, A_STMT_DO, A_STMT_SWITCH,
+    A_ASSIGN, A_EXPR, A_ASSIGN_EXPR, A_WHILE, A_DO, A_SWITCH, A_SWITCH_END,
+    A_CASE, A_CASE_BODY,
+    A_PRIMARY, A_CONDITION, A_RELOP, A_RIGHT_OPERAND
+};
+
+struct grammar_item
+{
+    int sym; // token_type, nonterminal or parse_action
+    const char* msg; // syntax error when the next token is not this terminal
+};
+
+#define MAX_RHS 8
+
+struct production
+{
+    int lhs;
+    struct grammar_item rhs[MAX_RHS]; // ends at the first zero sym
+};
+
+#define T(tok, msg) { tok, msg }
+#define N(sym) { sym, NULL }
+
+static const struct production grammar[] =
+{
+    { NT_PROGRAM,              { N(NT_DECL), N(A_DECL_END), N(NT_BODY), N(A_PROGRAM) } },
+
+    { NT_DECL,                 { N(A_DECL), N(NT_TYPE_DECL_SECTION), N(NT_VAR_DECL_SECTION_OPT) } },
+    { NT_DECL,                 { N(A_DECL), N(NT_VAR_DECL_SECTION) } },
+    { NT_DECL,                 { N(A_DECL) } },
+    { NT_VAR_DECL_SECTION_OPT, { N(NT_VAR_DECL_SECTION) } },
+    { NT_VAR_DECL_SECTION_OPT, { { 0 } } },
+
+    { NT_TYPE_DECL_SECTION,    { T(TYPE, NULL), N(NT_TYPE_DECL_LIST), N(A_TYPE_SECTION) } },
+    { NT_TYPE_DECL_LIST,       { N(NT_TYPE_DECL), N(A_TYPE_DECL_FIRST), N(NT_TYPE_DECL_MORE), N(A_LIST_END) } },
+    { NT_TYPE_DECL_MORE,       { N(NT_TYPE_DECL), N(A_TYPE_DECL_NEXT), N(NT_TYPE_DECL_MORE) } },
+    { NT_TYPE_DECL_MORE,       { { 0 } } },
+    { NT_TYPE_DECL,            { N(NT_ID_LIST), T(COLON, "type_decl. COLON expected"), N(NT_TYPE_NAME),
+                                 T(SEMICOLON, "type_decl. SEMICOLON expected"), N(A_TYPE_DECL) } },
+
+    { NT_VAR_DECL_SECTION,     { T(VAR, NULL), N(NT_VAR_DECL_LIST), N(A_VAR_SECTION) } },
+    { NT_VAR_DECL_LIST,        { N(NT_VAR_DECL), N(A_VAR_DECL_FIRST), N(NT_VAR_DECL_MORE), N(A_LIST_END) } },
+    { NT_VAR_DECL_MORE,        { N(NT_VAR_DECL), N(A_VAR_DECL_NEXT), N(NT_VAR_DECL_MORE) } },
+    { NT_VAR_DECL_MORE,        { { 0 } } },
+    { NT_VAR_DECL,             { N(NT_ID_LIST), T(COLON, "var_decl. COLON expected"), N(NT_TYPE_NAME),
+                                 T(SEMICOLON, "var_decl. SEMICOLON expected"), N(A_VAR_DECL) } },
+
+    { NT_ID_LIST,              { T(ID, NULL), N(A_ID_FIRST), N(NT_ID_LIST_MORE), N(A_LIST_END) } },
+    { NT_ID_LIST_MORE,         { T(COMMA, NULL), T(ID, "id_list. ID expected"), N(A_ID_NEXT), N(NT_ID_LIST_MORE) } },
+    { NT_ID_LIST_MORE,         { { 0 } } },
+
+    { NT_TYPE_NAME,            { T(ID, NULL), N(A_TYPE_NAME) } },
+    { NT_TYPE_NAME,            { T(INT, NULL), N(A_TYPE_NAME) } },
+    { NT_TYPE_NAME,            { T(REAL, NULL), N(A_TYPE_NAME) } },
+    { NT_TYPE_NAME,            { T(STRING, NULL), N(A_TYPE_NAME) } },
+    { NT_TYPE_NAME,            { T(BOOLEAN, NULL), N(A_TYPE_NAME) } },
+    { NT_TYPE_NAME,            { T(LONG, NULL), N(A_TYPE_NAME) } },
+
+    { NT_BODY,                 { T(LBRACE, NULL), N(NT_STMT_LIST), T(RBRACE, "body. RBRACE expected"), N(A_BODY) } },
+    { NT_STMT_LIST,            { N(NT_STMT), N(A_STMT_FIRST), N(NT_STMT_MORE), N(A_LIST_END) } },
+    { NT_STMT_MORE,            { N(NT_STMT), N(A_STMT_NEXT), N(NT_STMT_MORE) } },
+    { NT_STMT_MORE,            { { 0 } } },
+    { NT_STMT,                 { N(NT_ASSIGN_STMT), N(A_STMT_ASSIGN) } },
+    { NT_STMT,                 { N(NT_WHILE_STMT), N(A_STMT_WHILE) } },
+    { NT_STMT,                 { N(NT_DO_STMT), N(A_STMT_DO) } },
+    { NT_STMT,                 { N(NT_SWITCH_STMT), N(A_STMT_SWITCH) } },
+
+    // Expressions are parsed by expression(), see A_EXPR
+    { NT_ASSIGN_STMT,          { T(ID, NULL), N(A_ASSIGN), T(EQUAL, "assign_stmt. EQUAL expected"), N(A_EXPR),
+                                 T(SEMICOLON, "asign_stmt. SEMICOLON expected"), N(A_ASSIGN_EXPR) } },
+    { NT_WHILE_STMT,           { T(WHILE, NULL), N(NT_CONDITION), N(NT_BODY), N(A_WHILE) } },
+    { NT_DO_STMT,              { T(DO, NULL), N(NT_BODY), T(WHILE, "do_stmt. WHILE expected"), N(NT_CONDITION),
+                                 T(SEMICOLON, "do_stmt. SEMICOLON expected"), N(A_DO) } },
+    { NT_SWITCH_STMT,          { T(SWITCH, NULL), T(ID, "switch_stmt. ID expected"), N(A_SWITCH),
+                                 T(LBRACE, "switch_stmt. LBRACE expected"), N(NT_CASE_LIST),
+                                 T(RBRACE, "switch_stmt. RBRACE expected"), N(A_SWITCH_END) } },
+    { NT_CASE_LIST,            { N(NT_CASE), N(A_CASE_FIRST), N(NT_CASE_MORE), N(A_LIST_END) } },
+    { NT_CASE_MORE,            { N(NT_CASE), N(A_CASE_NEXT), N(NT_CASE_MORE) } },
+    { NT_CASE_MORE,            { { 0 } } },
+    { NT_CASE,                 { T(CASE, NULL), T(NUM, "case. NUM expected"), N(A_CASE),
+                                 T(COLON, "case. COLON expected"), N(NT_BODY), N(A_CASE_BODY) } },
+
+    { NT_CONDITION,            { N(NT_PRIMARY), N(A_CONDITION), N(NT_CONDITION_TAIL) } },
+    { NT_CONDITION_TAIL,       { T(GREATER, NULL), N(A_RELOP), N(NT_PRIMARY), N(A_RIGHT_OPERAND) } },
+    { NT_CONDITION_TAIL,       { T(GTEQ, NULL), N(A_RELOP), N(NT_PRIMARY), N(A_RIGHT_OPERAND) } },
+    { NT_CONDITION_TAIL,       { T(LESS, NULL), N(A_RELOP), N(NT_PRIMARY), N(A_RIGHT_OPERAND) } },
+    { NT_CONDITION_TAIL,       { T(NOTEQUAL, NULL), N(A_RELOP), N(NT_PRIMARY), N(A_RIGHT_OPERAND) } },
+    { NT_CONDITION_TAIL,       { T(LTEQ, NULL), N(A_RELOP), N(NT_PRIMARY), N(A_RIGHT_OPERAND) } },
+    { NT_CONDITION_TAIL,       { { 0 } } },
+    { NT_PRIMARY,              { T(NUM, NULL), N(A_PRIMARY) } },
+    { NT_PRIMARY,              { T(REALNUM, NULL), N(A_PRIMARY) } },
+    { NT_PRIMARY,              { T(ID, NULL), N(A_PRIMARY) } },
+};
+
+#undef T
+#undef N
+
+#define PRODUCTION_COUNT ((int) (sizeof(grammar) / sizeof(grammar[0])))
+
+static const char* nonterminal_error[NT_COUNT] =
+{
+    [NT_PROGRAM - NT_PROGRAM] = "program. TYPE or VAR or LBRACE expected",
+    [NT_DECL - NT_PROGRAM] = "decl. LBRACE expected",
+    [NT_TYPE_DECL_SECTION - NT_PROGRAM] = "type_decl_section. TYPE expected",
+    [NT_VAR_DECL_SECTION - NT_PROGRAM] = "var_decl_section. VAR expected",
+    [NT_TYPE_DECL_LIST - NT_PROGRAM] = "type_decl_list. ID expected",
+    [NT_TYPE_DECL - NT_PROGRAM] = "type_decl. ID expected",
+    [NT_VAR_DECL_LIST - NT_PROGRAM] = "var_decl_list. ID expected",
+    [NT_VAR_DECL - NT_PROGRAM] = "var_decl. ID expected",
+    [NT_ID_LIST - NT_PROGRAM] = "id_list. ID expected",
+    [NT_ID_LIST_MORE - NT_PROGRAM] = "id_list. COMMA or COLON expected",
+    [NT_TYPE_NAME - NT_PROGRAM] = "type_name. type name expected",
+    [NT_BODY - NT_PROGRAM] = "body. LBRACE expected",
+    [NT_STMT_LIST - NT_PROGRAM] = "stmt_list. ID, WHILE, DO or SWITCH expected",
+    [NT_STMT - NT_PROGRAM] = "stmt. ID, WHILE, DO or SWITCH expected",
+    [NT_ASSIGN_STMT - NT_PROGRAM] = "assign_stmt. ID expected",
+    [NT_WHILE_STMT - NT_PROGRAM] = "while_stmt. WHILE expected",
+    [NT_DO_STMT - NT_PROGRAM] = "do_stmt. DO expected",
+    [NT_SWITCH_STMT - NT_PROGRAM] = "switch_stmt. SWITCH expected",
+    [NT_CASE_LIST - NT_PROGRAM] = "case_list. CASE expected",
+    [NT_CASE - NT_PROGRAM] = "case. CASE expected",
+    [NT_CONDITION - NT_PROGRAM] = "condition. NUM, REALNUM, or ID expected",
+    [NT_PRIMARY - NT_PROGRAM] = "primary. NUM, REALNUM, or ID expected",
+};
+
+// Table columns are token types shifted by one so END_OF_FILE is column 0
+#define TERMINAL_COUNT (ERROR + 2)
+#define NO_PRODUCTION -1
+
+static short parse_table[NT_COUNT][TERMINAL_COUNT];
+static uint64_t first_set[NT_COUNT];
+
+// FIRST set of a right hand side as a bit per table column
+static uint64_t rhs_first(const struct grammar_item* rhs, const uint64_t* first,
+                          const bool* nullable, bool* rhs_nullable)
+{
+    uint64_t set = 0;
+    int i;
+
+    for (i = 0; i < MAX_RHS && rhs[i].sym != 0; i++)
+    {
+        if (rhs[i].sym < NT_PROGRAM)
+        {
+            *rhs_nullable = false;
+            return set | (1ULL << (rhs[i].sym + 1));
+        }
+        if (rhs[i].sym < NT_END)
+        {
+            set |= first[rhs[i].sym - NT_PROGRAM];
+            if (!nullable[rhs[i].sym - NT_PROGRAM])
+            {
+                *rhs_nullable = false;
+                return set;
+            }
+        }
+    }
+    *rhs_nullable = true;
+    return set;
+}
+
+static void set_parse_entry(int nt, int column, int p)
+{
+    // Two productions for one entry means the grammar is not LL(1)
+    assert(parse_table[nt][column] == NO_PRODUCTION || parse_table[nt][column] == p);
+    parse_table[nt][column] = p;
+}
+
+/*
+ * Computes FIRST and FOLLOW of every nonterminal and fills parse_table[]
+ * from them. This runs once at startup, before the first parse.
+ */
+static void init_parse_table()
+{
+    uint64_t* first = first_set;
+    uint64_t follow[NT_COUNT] = { 0 };
+    bool nullable[NT_COUNT] = { false };
+    uint64_t set;
+    bool changed, rest_nullable;
+    int p, i, nt, column;
+
+    do
+    {
+        changed = false;
+        for (p = 0; p < PRODUCTION_COUNT; p++)
+        {
+            nt = grammar[p].lhs - NT_PROGRAM;
+            set = rhs_first(grammar[p].rhs, first, nullable, &rest_nullable);
+            if ((first[nt] | set) != first[nt] || (rest_nullable && !nullable[nt]))
+            {
+                first[nt] |= set;
+                nullable[nt] |= rest_nullable;
+                changed = true;
+            }
+        }
+    } while (changed);
+
+    do
+    {
+        changed = false;
+        for (p = 0; p < PRODUCTION_COUNT; p++)
+        {
+            for (i = 0; i < MAX_RHS && grammar[p].rhs[i].sym != 0; i++)
+            {
+                if (grammar[p].rhs[i].sym < NT_PROGRAM || grammar[p].rhs[i].sym >= NT_END)
+                {
+                    continue;
+                }
+                nt = grammar[p].rhs[i].sym - NT_PROGRAM;
+                set = rhs_first(grammar[p].rhs + i + 1, first, nullable, &rest_nullable);
+                if (rest_nullable)
+                {
+                    set |= follow[grammar[p].lhs - NT_PROGRAM];
+                }
+                if ((follow[nt] | set) != follow[nt])
+                {
+                    follow[nt] |= set;
+                    changed = true;
+                }
+            }
+        }
+    } while (changed);
+
+    memset(parse_table, 0xff, sizeof(parse_table));
+    for (p = 0; p < PRODUCTION_COUNT; p++)
+    {
+        nt = grammar[p].lhs - NT_PROGRAM;
+        set = rhs_first(grammar[p].rhs, first, nullable, &rest_nullable);
+        if (rest_nullable)
+        {
+            set |= follow[nt];
+        }
+        for (column = 0; column < TERMINAL_COUNT; column++)
+        {
+            if (set & (1ULL << column))
+            {
+                set_parse_entry(nt, column, p);
+            }
+        }
+    }
+
+    // Without an error of their own, nonterminals take their empty
+    // production on any other token and let the caller report it
+    for (p = 0; p < PRODUCTION_COUNT; p++)
+    {
+        nt = grammar[p].lhs - NT_PROGRAM;
+        if (nonterminal_error[nt] == NULL && grammar[p].rhs[0].sym == 0)
+        {
+            for (column = 0; column < TERMINAL_COUNT; column++)
+            {
+                if (parse_table[nt][column] == NO_PRODUCTION)
+                {
+                    parse_table[nt][column] = p;
+                }
+            }
+        }
+    }
+}
+
+static inline void push_item(struct parse_stack* ps, const struct grammar_item* item)
+{
+    if (ps->count == ps->capacity)
+    {
+        ps->capacity = ps->capacity ? 2 * ps->capacity : 256;
+        ps->item = realloc(ps->item, ps->capacity * sizeof(*ps->item));
+    }
+    ps->item[ps->count++] = item;
+}
+
+static inline void push_value(struct parse_stack* ps, void* value)
+{
+    if (ps->value_count == ps->value_capacity)
+    {
+        ps->value_capacity = ps->value_capacity ? 2 * ps->value_capacity : 256;
+        ps->value = realloc(ps->value, ps->value_capacity * sizeof(*ps->value));
+    }
+    ps->value[ps->value_count++] = value;
+}
+
+static inline void* pop_value(struct parse_stack* ps)
+{
+    return ps->value[--ps->value_count];
+}
+
+static inline void* top_value(struct parse_stack* ps)
+{
+    return ps->value[ps->value_count - 1];
+}
+
+// Primary for the NUM, REALNUM or ID token just taken
+static struct primaryNode* new_primary(struct checker* ctx)
+{
+    struct primaryNode* prmryNode = ALLOC(ctx, struct primaryNode);
+
+    prmryNode->tag = ctx->t_type;
+    if (ctx->t_type == NUM)
+    {
+        prmryNode->ival = token_int(ctx);
+    }
+    else if (ctx->t_type == REALNUM)
+    {
+        prmryNode->fval = token_float(ctx);
+    }
+    else
+    {
+        prmryNode->id = token_symbol(ctx);
+        use_variable_name(ctx, prmryNode->id, token_line(ctx));
+    }
+    return prmryNode;
+}
+
+/* -------------------- EXPRESSIONS -------------------- */
+
+// Binding power of a binary operator, 0 when the token is not one
+static inline int precedence(int op)
+{
+    if (op == MULT || op == DIV)
+    {
+        return 2;
+    }
+    if (op == PLUS || op == MINUS)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+static inline void push_op(struct parse_stack* ps, int op)
+{
+    if (ps->op_count == ps->op_capacity)
+    {
+        ps->op_capacity = ps->op_capacity ? 2 * ps->op_capacity : 64;
+        ps->op = realloc(ps->op, ps->op_capacity * sizeof(*ps->op));
+    }
+    ps->op[ps->op_count++] = op;
+}
+
+// Replaces the top two operands with the top operator applied to them
+static void reduce_op(struct checker* ctx)
+{
+    struct parse_stack* ps = &ctx->parse;
+    struct exprNode* exp = ALLOC(ctx, struct exprNode);
+
+    exp->tag = EXPR;
+    exp->op = ps->op[--ps->op_count];
+    exp->rightOperand = pop_value(ps);
+    exp->leftOperand = pop_value(ps);
+    push_value(ps, exp);
+}
+
+/*
+ * Parses an expression with an operator stack instead of recursion and
+ * pushes its tree on the value stack. An operator first reduces the
+ * pending ones that bind at least as tightly, so equal precedence
+ * associates to the left: a - b - c is (a - b) - c. Parentheses sit on
+ * the operator stack as LPAREN. The expression ends at a SEMICOLON or at
+ * an RPAREN that does not close anything, which is left to the caller.
+ */
+static void expression(struct checker* ctx)
+{
+    struct parse_stack* ps = &ctx->parse;
+    struct exprNode* facto;
+    int base = ps->op_count;
+    int open = 0; // unclosed parentheses
+    const char* operand_error = "expr. ID, LPAREN, NUM, or REALNUM expected";
+
+    while (true)
+    {
+        ctx->t_type = getToken(ctx);
+        if (ctx->t_type == LPAREN)
+        {
+            push_op(ps, LPAREN);
+            open++;
+            operand_error = "expr. ID, LPAREN, NUM, or REALNUM expected";
+            continue;
+        }
+        if (ctx->t_type != ID && ctx->t_type != NUM && ctx->t_type != REALNUM)
+        {
+            syntax_error(ctx, operand_error);
+        }
+        facto = ALLOC(ctx, struct exprNode);
+        facto->tag = PRIMARY;
+        facto->op = NOOP;
+        facto->primary = new_primary(ctx);
+        push_value(ps, facto);
+
+        ctx->t_type = peek(ctx, 0);
+        while (ctx->t_type == RPAREN && open > 0)
+        {
+            getToken(ctx);
+            while (ps->op[ps->op_count - 1] != LPAREN)
+            {
+                reduce_op(ctx);
+            }
+            ps->op_count--;
+            open--;
+            ctx->t_type = peek(ctx, 0);
+        }
+
+        if (precedence(ctx->t_type) > 0)
+        {
+            getToken(ctx);
+            while (ps->op_count > base && ps->op[ps->op_count - 1] != LPAREN &&
+                   precedence(ps->op[ps->op_count - 1]) >= precedence(ctx->t_type))
+            {
+                reduce_op(ctx);
+            }
+            push_op(ps, ctx->t_type);
+            operand_error = ctx->t_type == MULT || ctx->t_type == DIV ?
+                "term. ID, LPAREN, NUM, or REALNUM expected" :
+                "expr. ID, LPAREN, NUM, or REALNUM expected";
+        }
+        else if (ctx->t_type == SEMICOLON && open > 0)
+        {
+            getToken(ctx);
+            syntax_error(ctx, "factor. RPAREN expected");
+        }
+        else if (ctx->t_type == SEMICOLON || ctx->t_type == RPAREN)
+        {
+            while (ps->op_count > base)
+            {
+                reduce_op(ctx);
+            }
+            return;
+        }
+        else
+        {
+            syntax_error(ctx, "term. MULT or DIV expected");
+        }
+    }
+}
+
+static int compare_cases(const void* a, const void* b)
+{
+    const struct caseNode* x = *(const struct caseNode* const*) a;
+    const struct caseNode* y = *(const struct caseNode* const*) b;
+
+    if (x->num != y->num)
+    {
+        return x->num < y->num ? -1 : 1;
+    }
+    return x->lineNumberTracker - y->lineNumberTracker;
+}
+
+// Fills the switch's case array, ordered by label, from its case list
+static void sort_cases(struct checker* ctx, struct switch_stmtNode* switc)
+{
+    struct case_listNode* caseList;
+    uint32_t n = 0;
+
+    for (caseList = switc->case_list; caseList != NULL; caseList = caseList->case_list)
+    {
+        n++;
+    }
+    switc->cases = arena_alloc(&ctx->tree_arena, n * sizeof(*switc->cases), _Alignof(struct caseNode*));
+    switc->case_count = n;
+    n = 0;
+    for (caseList = switc->case_list; caseList != NULL; caseList = caseList->case_list)
+    {
+        caseList->cas->position = n;
+        switc->cases[n++] = caseList->cas;
+    }
+    qsort(switc->cases, switc->case_count, sizeof(*switc->cases), compare_cases);
+}
+
+/*
+ * Runs one action. Lists are built through two values, the head and the
+ * current tail; A_LIST_END drops the tail once the list is complete.
+ */
+static void run_action(struct checker* ctx, int action)
+{
+    struct parse_stack* ps = &ctx->parse;
+
+    switch (action)
+    {
+        case A_PROGRAM:
+        {
+            struct programNode* prog = ALLOC(ctx, struct programNode);
+            prog->body = pop_value(ps);
+            prog->decl = pop_value(ps);
+            push_value(ps, prog);
+            break;
+        }
+        case A_DECL:
+            push_value(ps, ALLOC(ctx, struct declNode));
+            break;
+        case A_DECL_END:
+            resolve_type_aliases(ctx);
+            if (ctx->options.stop_at_first_error)
+            {
+                stop_at_declaration_errors(ctx);
+            }
+            break;
+        case A_TYPE_SECTION:
+        {
+            struct type_decl_sectionNode* typeDeclSection = ALLOC(ctx, struct type_decl_sectionNode);
+            typeDeclSection->type_decl_list = pop_value(ps);
+            ((struct declNode*) top_value(ps))->type_decl_section = typeDeclSection;
+            if (ctx->options.stop_at_first_error && ctx->decls.dup_types.count > 0)
+            {
+                stop_at_declaration_errors(ctx);
+            }
+            break;
+        }
+        case A_VAR_SECTION:
+        {
+            struct var_decl_sectionNode* varDeclSection = ALLOC(ctx, struct var_decl_sectionNode);
+            varDeclSection->var_decl_list = pop_value(ps);
+            ((struct declNode*) top_value(ps))->var_decl_section = varDeclSection;
+            break;
+        }
+        case A_TYPE_DECL_FIRST:
+        case A_TYPE_DECL_NEXT:
+        {
+            struct type_decl_listNode* typeDeclList = ALLOC(ctx, struct type_decl_listNode);
+            typeDeclList->type_decl = pop_value(ps);
+            if (action == A_TYPE_DECL_NEXT)
+            {
+                ((struct type_decl_listNode*) pop_value(ps))->type_decl_list = typeDeclList;
+            }
+            else
+            {
+                push_value(ps, typeDeclList);
+            }
+            push_value(ps, typeDeclList);
+            break;
+        }
+        case A_VAR_DECL_FIRST:
+        case A_VAR_DECL_NEXT:
+        {
+            struct var_decl_listNode* varDeclList = ALLOC(ctx, struct var_decl_listNode);
+            varDeclList->var_decl = pop_value(ps);
+            if (action == A_VAR_DECL_NEXT)
+            {
+                ((struct var_decl_listNode*) pop_value(ps))->var_decl_list = varDeclList;
+            }
+            else
+            {
+                push_value(ps, varDeclList);
+            }
+            push_value(ps, varDeclList);
+            break;
+        }
+        case A_ID_FIRST:
+        case A_ID_NEXT:
+        {
+            struct id_listNode* idList = ALLOC(ctx, struct id_listNode);
+            idList->id = token_symbol(ctx);
+            idList->lineNumberTracker = token_line(ctx);
+            if (action == A_ID_NEXT)
+            {
+                ((struct id_listNode*) pop_value(ps))->id_list = idList;
+            }
+            else
+            {
+                push_value(ps, idList);
+            }
+            push_value(ps, idList);
+            break;
+        }
+        case A_STMT_FIRST:
+        case A_STMT_NEXT:
+        {
+            struct stmt_listNode* stmtList = ALLOC(ctx, struct stmt_listNode);
+            stmtList->stmt = pop_value(ps);
+            if (action == A_STMT_NEXT)
+            {
+                ((struct stmt_listNode*) pop_value(ps))->stmt_list = stmtList;
+            }
+            else
+            {
+                push_value(ps, stmtList);
+            }
+            push_value(ps, stmtList);
+            break;
+        }
+        case A_CASE_FIRST:
+        case A_CASE_NEXT:
+        {
+            struct case_listNode* caseList = ALLOC(ctx, struct case_listNode);
+            caseList->cas = pop_value(ps);
+            if (action == A_CASE_NEXT)
+            {
+                ((struct case_listNode*) pop_value(ps))->case_list = caseList;
+            }
+            else
+            {
+                push_value(ps, caseList);
+            }
+            push_value(ps, caseList);
+            break;
+        }
+        case A_LIST_END:
+            pop_value(ps);
+            break;
+        case A_TYPE_DECL:
+        {
+            struct type_declNode* typeDecl = ALLOC(ctx, struct type_declNode);
+            struct id_listNode* idList;
+            typeDecl->type_name = pop_value(ps);
+            typeDecl->id_list = pop_value(ps);
+            for (idList = typeDecl->id_list; idList != NULL; idList = idList->id_list)
+            {
+                declare_type_name(ctx, idList->id, idList->lineNumberTracker,
+                                  typeDecl->type_name->type, typeDecl->type_name->id);
+            }
+            push_value(ps, typeDecl);
+            break;
+        }
+        case A_VAR_DECL:
+        {
+            struct var_declNode* varDecl = ALLOC(ctx, struct var_declNode);
+            struct id_listNode* idList;
+            varDecl->type_name = pop_value(ps);
+            varDecl->id_list = pop_value(ps);
+            for (idList = varDecl->id_list; idList != NULL; idList = idList->id_list)
+            {
+                declare_var_name(ctx, idList->id, idList->lineNumberTracker,
+                                 varDecl->type_name->type, varDecl->type_name->id);
+            }
+            use_type_name(ctx, varDecl->type_name->type, varDecl->type_name->id);
+            push_value(ps, varDecl);
+            break;
+        }
+        case A_TYPE_NAME:
+        {
+            struct type_nameNode* tName = ALLOC(ctx, struct type_nameNode);
+            tName->type = ctx->t_type;
+            tName->id = ctx->t_type == ID ? token_symbol(ctx) : 0;
+            push_value(ps, tName);
+            break;
+        }
+        case A_BODY:
+        {
+            struct bodyNode* bod = ALLOC(ctx, struct bodyNode);
+            bod->stmt_list = pop_value(ps);
+            push_value(ps, bod);
+            break;
+        }
+        case A_STMT_ASSIGN:
+        case A_STMT_WHILE:
+        case A_STMT_DO:
+        case A_STMT_SWITCH:
+        {
+            struct stmtNode* stm = ALLOC(ctx, struct stmtNode);
+            if (action == A_STMT_ASSIGN)
+            {
+                stm->stmtType = ASSIGN;
+                stm->assign_stmt = pop_value(ps);
+            }
+            else if (action == A_STMT_SWITCH)
+            {
+                stm->stmtType = SWITCH;
+                stm->switch_stmt = pop_value(ps);
+            }
+            else
+            {
+                stm->stmtType = action == A_STMT_WHILE ? WHILE : DO;
+                stm->while_stmt = pop_value(ps);
+            }
+            push_value(ps, stm);
+            break;
+        }
+        case A_ASSIGN:
+        {
+            struct assign_stmtNode* assignStmt = ALLOC(ctx, struct assign_stmtNode);
+            assignStmt->id = token_symbol(ctx);
+            assignStmt->lineNumberTracker = token_line(ctx);
+            use_variable_name(ctx, assignStmt->id, assignStmt->lineNumberTracker);
+            push_value(ps, assignStmt);
+            break;
+        }
+        case A_EXPR:
+            expression(ctx);
+            break;
+        case A_ASSIGN_EXPR:
+        {
+            struct exprNode* exp = pop_value(ps);
+            ((struct assign_stmtNode*) top_value(ps))->expr = exp;
+            break;
+        }
+        case A_WHILE:
+        {
+            struct while_stmtNode* whileStmt = ALLOC(ctx, struct while_stmtNode);
+            whileStmt->body = pop_value(ps);
+            whileStmt->condition = pop_value(ps);
+            push_value(ps, whileStmt);
+            break;
+        }
+        case A_DO:
+        {
+            struct while_stmtNode* doStatement = ALLOC(ctx, struct while_stmtNode);
+            doStatement->condition = pop_value(ps);
+            doStatement->body = pop_value(ps);
+            push_value(ps, doStatement);
+            break;
+        }
+        case A_SWITCH:
+        {
+            struct switch_stmtNode* switc = ALLOC(ctx, struct switch_stmtNode);
+            switc->id = token_symbol(ctx);
+            use_variable_name(ctx, switc->id, token_line(ctx));
+            push_value(ps, switc);
+            break;
+        }
+        case A_SWITCH_END:
+        {
+            struct case_listNode* caseList = pop_value(ps);
+            ((struct switch_stmtNode*) top_value(ps))->case_list = caseList;
+            sort_cases(ctx, top_value(ps));
+            break;
+        }
+        case A_CASE:
+        {
+            struct caseNode* cas = ALLOC(ctx, struct caseNode);
+            cas->num = token_int(ctx);
+            cas->lineNumberTracker = token_line(ctx);
+            push_value(ps, cas);
+            break;
+        }
+        case A_CASE_BODY:
+        {
+            struct bodyNode* bod = pop_value(ps);
+            ((struct caseNode*) top_value(ps))->body = bod;
+            break;
+        }
+        case A_PRIMARY:
+            push_value(ps, new_primary(ctx));
+            break;
+        case A_CONDITION:
+        {
+            struct conditionNode* condNde = ALLOC(ctx, struct conditionNode);
+            condNde->left_operand = pop_value(ps);
+            condNde->lineNumberTracker = token_line(ctx);
+            push_value(ps, condNde);
+            break;
+        }
+        case A_RELOP:
+            ((struct conditionNode*) top_value(ps))->relop = ctx->t_type;
+            break;
+        case A_RIGHT_OPERAND:
+        {
+            struct primaryNode* right = pop_value(ps);
+            ((struct conditionNode*) top_value(ps))->right_operand = right;
+            break;
+        }
+    }
+}
+
+// Whether the symbol can start with token t
+static inline bool symbol_accepts(int sym, token_type t)
+{
+    if (sym < NT_PROGRAM)
+    {
+        return sym == t;
+    }
+    if (sym < NT_END)
+    {
+        return (first_set[sym - NT_PROGRAM] >> (t + 1)) & 1;
+    }
+    return false;
+}
+
+/*
+ * Panic-mode recovery: skips from the offending token to the next
+ * SEMICOLON, LBRACE or RBRACE and pops the symbol stack down to the
+ * nearest symbol that can take it. A SEMICOLON nothing takes is skipped
+ * too, and the token after it is tried the same way, so parsing resumes
+ * at the next statement, declaration or body. The rest of the tree is not
+ * built.
+ */
+static void recover_from_syntax_error(struct checker* ctx)
+{
+    struct parse_stack* ps = &ctx->parse;
+    token_type t;
+    bool after_semicolon = false;
+    int k;
+
+    ps->building = false;
+    ps->value_count = 0;
+    ps->op_count = 0;
+    tok_rewind(ctx, ctx->tokens.furthest);
+    while (true)
+    {
+        t = peek(ctx, 0);
+        if (t == END_OF_FILE)
+        {
+            ps->count = 0;
+            return;
+        }
+        if (t == SEMICOLON || t == LBRACE || t == RBRACE || after_semicolon)
+        {
+            for (k = ps->count - 1; k >= 0; k--)
+            {
+                if (symbol_accepts(ps->item[k]->sym, t))
+                {
+                    ps->count = k + 1;
+                    return;
+                }
+            }
+        }
+        after_semicolon = t == SEMICOLON;
+        getToken(ctx);
+    }
+}
+
+/*
+ * Parses the whole token stream into a programNode tree. The driver loop
+ * pops one symbol at a time: terminals are matched against the next
+ * token, nonterminals are replaced by the right hand side parse_table[]
+ * picks for the next token, and actions build the tree.
+ */
+static struct programNode* program(struct checker* ctx)
+{
+    static const struct grammar_item start = { NT_PROGRAM, NULL };
+    // Kept in the context, so it is intact when syntax_error() jumps back
+    // here, and its buffers are reused by the next check
+    struct parse_stack* ps = &ctx->parse;
+    const struct grammar_item* item;
+    const struct grammar_item* rhs;
+    int p, n;
+
+    ps->count = 0;
+    ps->value_count = 0;
+    ps->op_count = 0;
+    ps->building = true;
+    push_item(ps, &start);
+    if (setjmp(ctx->syntax_recovery) != 0)
+    {
+        recover_from_syntax_error(ctx);
+    }
+    while (ps->count > 0)
+    {
+        item = ps->item[--ps->count];
+        if (item->sym < NT_PROGRAM)
+        {
+            ctx->t_type = getToken(ctx);
+            if (ctx->t_type != item->sym)
             {
-                return varDecl;
+                syntax_error(ctx, item->msg);
             }
-            else
+        }
+        else if (item->sym < NT_END)
+        {
+            p = parse_table[item->sym - NT_PROGRAM][peek(ctx, 0) + 1];
+            if (p == NO_PRODUCTION)
+            {
+                syntax_error(ctx, nonterminal_error[item->sym - NT_PROGRAM]);
+            }
+            rhs = grammar[p].rhs;
+            for (n = 0; n < MAX_RHS && rhs[n].sym != 0; n++)
+            {
+            }
+            while (n > 0)
             {
-                syntax_error("var_decl. SEMICOLON expected");
+                push_item(ps, &rhs[--n]);
             }
         }
-        else
+        else if (ps->building)
         {
-            syntax_error("var_decl. COLON expected");
+            run_action(ctx, item->sym);
+        }
+        else if (item->sym == A_EXPR || item->sym == A_PRIMARY || item->sym == A_CASE)
+        {
+            // Still parsed and checked after an error, but not kept
+            run_action(ctx, item->sym);
+            ps->value_count = 0;
         }
     }
-    else
+
+    if (ctx->syntax_error_count > 0)
     {
-        syntax_error("var_decl. ID expected");
+        abort_check(ctx, CHECK_SYNTAX_ERROR);
     }
-    assert(false);
-    return NULL; // control never reaches here, this is just for the sake of GCC
+    return pop_value(ps);
 }
 
-struct var_decl_listNode* var_decl_list()
+/* -------------------- FLATTENING PARSE TREE -------------------- */
+
+// Makes room for n more elements of ft->arr and returns the first one's index
+#define FLAT_RESERVE(ft, arr, n) \
+    flat_reserve((void**) &(ft)->arr, &(ft)->arr##_count, &(ft)->arr##_capacity, (n), sizeof(*(ft)->arr))
+
+static node_index flat_reserve(void** array, uint32_t* count, uint32_t* capacity, uint32_t n, size_t size)
 {
-    struct var_decl_listNode* varDeclList;
-    
-    varDeclList = ALLOC(struct var_decl_listNode);
-    t_type = getToken();
-    if (t_type == ID)
+    node_index start = *count;
+
+    if (*count + n > *capacity)
     {
-        ungetToken();
-        varDeclList->var_decl = var_decl();
-        t_type = getToken();
-        if (t_type == ID)
-        {
-            ungetToken();
-            varDeclList->var_decl_list = var_decl_list();
-            return varDeclList;
-        }
-        else
+        *capacity = *capacity ? 2 * *capacity : 1024;
+        if (*capacity < *count + n)
         {
-            ungetToken();
-            varDeclList->var_decl_list = NULL;
-            return varDeclList;
+            *capacity = *count + n;
         }
+        *array = realloc(*array, *capacity * size);
     }
-    else
+    *count += n;
+    return start;
+}
+
+/*
+ * Pending work for flatten_program(): a list whose elements still have to
+ * be written into the range reserved for them at dest. Nested bodies are
+ * queued instead of recursed into, so the pass uses no stack per level.
+ */
+struct flat_job
+{
+    int kind; // STMT_LIST, EXPR or CASE_LIST
+    void* node;
+    node_index dest;
+};
+
+struct flat_jobs
+{
+    struct flat_job* job;
+    int count;
+    int capacity;
+};
+
+enum { STMT_LIST, EXPR_NODE, CASE_LIST }; // CASE_LIST takes the switch_stmtNode
+
+static void push_flat_job(struct flat_jobs* jobs, int kind, void* node, node_index dest)
+{
+    if (jobs->count == jobs->capacity)
     {
-        syntax_error("var_decl_list. ID expected");
+        jobs->capacity = jobs->capacity ? 2 * jobs->capacity : 64;
+        jobs->job = realloc(jobs->job, jobs->capacity * sizeof(*jobs->job));
     }
-    assert(false);
-    return NULL; // control never reaches here, this is just for the sake of GCC
+    jobs->job[jobs->count].kind = kind;
+    jobs->job[jobs->count].node = node;
+    jobs->job[jobs->count].dest = dest;
+    jobs->count++;
 }
 
-struct type_decl_listNode* type_decl_list()
+static uint32_t stmt_list_length(struct stmt_listNode* list)
 {
-    struct type_decl_listNode* typeDeclList;
-    
-    typeDeclList = ALLOC(struct type_decl_listNode);
-    t_type = getToken();
-    if (t_type == ID)
+    uint32_t n = 0;
+
+    for (; list != NULL; list = list->stmt_list)
     {
-        ungetToken();
-        typeDeclList->type_decl = type_decl();
-        t_type = getToken();
-        if (t_type == ID)
-        {
-            ungetToken();
-            typeDeclList->type_decl_list = type_decl_list();
-            return typeDeclList;
-        }
-        else
-        {
-            ungetToken();
-            typeDeclList->type_decl_list = NULL;
-            return typeDeclList;
-        }
+        n++;
     }
-    else
+    return n;
+}
+
+// Reserves the statements of body and queues them to be filled in
+static struct flat_range flat_body(struct flat_tree* ft, struct flat_jobs* jobs, struct bodyNode* body)
+{
+    struct flat_range r;
+
+    r.count = body ? stmt_list_length(body->stmt_list) : 0;
+    r.start = FLAT_RESERVE(ft, stmts, r.count);
+    if (r.count > 0)
     {
-        syntax_error("type_decl_list. ID expected");
+        push_flat_job(jobs, STMT_LIST, body->stmt_list, r.start);
     }
-    assert(false);
-    return NULL; // control never reaches here, this is just for the sake of GCC
+    return r;
 }
 
-struct var_decl_sectionNode* var_decl_section()
+static void set_flat_primary(struct flat_expr* e, struct primaryNode* prim)
 {
-    struct var_decl_sectionNode *varDeclSection;
-    
-    varDeclSection = ALLOC(struct var_decl_sectionNode);
-    t_type = getToken();
-    if (t_type == VAR)
+    e->tag = prim->tag;
+    e->op = NOOP;
+    if (prim->tag == NUM)
+    {
+        e->ival = prim->ival;
+    }
+    else if (prim->tag == REALNUM)
     {
-        // no need to ungetToken()
-        varDeclSection->var_decl_list = var_decl_list();
-        return varDeclSection;
+        e->fval = prim->fval;
     }
     else
     {
-        syntax_error("var_decl_section. VAR expected");
+        e->id = prim->id;
     }
-    assert(false);
-    return NULL; // control never reaches here, this is just for the sake of GCC
 }
 
-struct type_decl_sectionNode* type_decl_section()
+static node_index flat_primary(struct flat_tree* ft, struct primaryNode* prim)
 {
-    struct type_decl_sectionNode *typeDeclSection;
-    
-    typeDeclSection = ALLOC(struct type_decl_sectionNode);
-    t_type = getToken();
-    if (t_type == TYPE)
-    {
-        typeDeclSection->type_decl_list = type_decl_list();
-        return typeDeclSection;
-    }
-    else
+    node_index i;
+
+    if (prim == NULL)
     {
-        syntax_error("type_decl_section. TYPE expected");
+        return NO_NODE;
     }
-    assert(false);
-    return NULL; // control never reaches here, this is just for the sake of GCC
+    i = FLAT_RESERVE(ft, exprs, 1);
+    set_flat_primary(&ft->exprs[i], prim);
+    return i;
 }
 
-struct declNode* decl()
+static struct flat_range flat_decl_list(struct flat_tree* ft, struct type_decl_listNode* typeDeclList,
+                                        struct var_decl_listNode* varDeclList)
 {
-    struct declNode* dec;
-    
-    dec = ALLOC(struct declNode);
-    dec->type_decl_section = NULL;
-    dec->var_decl_section = NULL;
-    t_type = getToken();
-    if (t_type == TYPE)
+    struct flat_range r;
+    struct id_listNode* idList;
+    struct type_nameNode* typeName;
+    node_index d, k;
+
+    r.start = ft->decls_count;
+    r.count = 0;
+    while (typeDeclList != NULL || varDeclList != NULL)
     {
-        ungetToken();
-        dec->type_decl_section = type_decl_section();
-        t_type = getToken();
-        if (t_type == VAR)
+        if (typeDeclList != NULL)
         {
-            // type_decl_list is epsilon
-            // or type_decl already parsed and the
-            // next token is checked
-            ungetToken();
-            dec->var_decl_section = var_decl_section();
+            idList = typeDeclList->type_decl->id_list;
+            typeName = typeDeclList->type_decl->type_name;
+            typeDeclList = typeDeclList->type_decl_list;
         }
         else
         {
-            ungetToken();
-            dec->var_decl_section = NULL;
-        }
-        return dec;
-    }
-    else
-    {
-        dec->type_decl_section = NULL;
-        if (t_type == VAR)
-        {
-            // type_decl_list is epsilon
-            // or type_decl already parsed and the
-            // next token is checked
-            ungetToken();
-            dec->var_decl_section = var_decl_section();
-            return dec;
+            idList = varDeclList->var_decl->id_list;
+            typeName = varDeclList->var_decl->type_name;
+            varDeclList = varDeclList->var_decl_list;
         }
-        else
+        d = FLAT_RESERVE(ft, decls, 1);
+        ft->decls[d].ids.start = ft->ids_count;
+        ft->decls[d].ids.count = 0;
+        ft->decls[d].lineNumberTracker = idList->lineNumberTracker;
+        for (; idList != NULL; idList = idList->id_list)
         {
-            if (t_type == LBRACE)
-            {
-                ungetToken();
-                dec->var_decl_section = NULL;
-                return dec;
-            }
-            else
-            {
-                syntax_error("decl. LBRACE expected");
-            }
+            k = FLAT_RESERVE(ft, ids, 1);
+            ft->ids[k] = idList->id;
+            ft->decls[d].ids.count++;
         }
+        ft->decls[d].type = typeName->type;
+        ft->decls[d].id = typeName->id;
+        r.count++;
     }
-    assert(false);
-    return NULL; // control never reaches here, this is just for the sake of GCC
+    return r;
 }
 
-struct programNode* program()
+static void flatten_program(struct flat_tree* ft, struct programNode* prog)
 {
-    struct programNode* prog;
-    
-    prog = ALLOC(struct programNode);
-    t_type = getToken();
-    if (t_type == TYPE || t_type == VAR || t_type == LBRACE)
+    struct flat_jobs jobs = { NULL, 0, 0 };
+    struct flat_job job;
+    struct stmt_listNode* stmtList;
+    struct switch_stmtNode* switc;
+    struct stmtNode* stm;
+    struct exprNode* exp;
+    struct flat_range r;
+    node_index i, k, left, right;
+
+    memset(ft, 0, sizeof(*ft));
+    if (prog->decl->type_decl_section != NULL)
     {
-        ungetToken();
-        prog->decl = decl();
-        prog->body = body();
-        return prog;
+        ft->type_decls = flat_decl_list(ft, prog->decl->type_decl_section->type_decl_list, NULL);
     }
-    else
+    if (prog->decl->var_decl_section != NULL)
+    {
+        ft->var_decls = flat_decl_list(ft, NULL, prog->decl->var_decl_section->var_decl_list);
+    }
+    ft->body = flat_body(ft, &jobs, prog->body);
+
+    // ft->stmts and ft->exprs can move on every reserve, so entries are
+    // only written through an index after the reservations they need
+    while (jobs.count > 0)
     {
-        syntax_error("program. TYPE or VAR or LBRACE expected");
+        job = jobs.job[--jobs.count];
+        switch (job.kind)
+        {
+            case STMT_LIST:
+                i = job.dest;
+                for (stmtList = job.node; stmtList != NULL; stmtList = stmtList->stmt_list, i++)
+                {
+                    stm = stmtList->stmt;
+                    ft->stmts[i].stmtType = stm->stmtType;
+                    ft->stmts[i].relop = 0;
+                    if (stm->stmtType == ASSIGN)
+                    {
+                        left = FLAT_RESERVE(ft, exprs, 1);
+                        push_flat_job(&jobs, EXPR_NODE, stm->assign_stmt->expr, left);
+                        ft->stmts[i].assign.id = stm->assign_stmt->id;
+                        ft->stmts[i].assign.expr = left;
+                        ft->stmts[i].assign.lineNumberTracker = stm->assign_stmt->lineNumberTracker;
+                    }
+                    else if (stm->stmtType == WHILE || stm->stmtType == DO)
+                    {
+                        left = flat_primary(ft, stm->while_stmt->condition->left_operand);
+                        right = flat_primary(ft, stm->while_stmt->condition->right_operand);
+                        r = flat_body(ft, &jobs, stm->while_stmt->body);
+                        ft->stmts[i].relop = right != NO_NODE ? stm->while_stmt->condition->relop : 0;
+                        ft->stmts[i].loop.left = left;
+                        ft->stmts[i].loop.right = right;
+                        ft->stmts[i].loop.body = r;
+                        ft->stmts[i].loop.lineNumberTracker = stm->while_stmt->condition->lineNumberTracker;
+                    }
+                    else if (stm->stmtType == SWITCH)
+                    {
+                        r.start = ft->cases_count;
+                        r.count = 0;
+                        if (stm->switch_stmt != NULL)
+                        {
+                            // Cases are kept ordered by label
+                            r.count = stm->switch_stmt->case_count;
+                            r.start = FLAT_RESERVE(ft, cases, r.count);
+                            if (r.count > 0)
+                            {
+                                push_flat_job(&jobs, CASE_LIST, stm->switch_stmt, r.start);
+                            }
+                        }
+                        ft->stmts[i].switc.id = stm->switch_stmt ? stm->switch_stmt->id : 0;
+                        ft->stmts[i].switc.cases = r;
+                    }
+                }
+                break;
+
+            case EXPR_NODE:
+                exp = job.node;
+                if (exp->tag == EXPR)
+                {
+                    // Both operands go next to each other
+                    left = FLAT_RESERVE(ft, exprs, 2);
+                    right = left + 1;
+                    push_flat_job(&jobs, EXPR_NODE, exp->rightOperand, right);
+                    push_flat_job(&jobs, EXPR_NODE, exp->leftOperand, left);
+                    ft->exprs[job.dest].tag = EXPR;
+                    ft->exprs[job.dest].op = exp->op;
+                    ft->exprs[job.dest].left = left;
+                    ft->exprs[job.dest].right = right;
+                }
+                else
+                {
+                    set_flat_primary(&ft->exprs[job.dest], exp->primary);
+                }
+                break;
+
+            case CASE_LIST:
+                switc = job.node;
+                for (k = 0; k < switc->case_count; k++)
+                {
+                    r = flat_body(ft, &jobs, switc->cases[k]->body);
+                    ft->cases[job.dest + k].num = switc->cases[k]->num;
+                    ft->cases[job.dest + k].lineNumberTracker = switc->cases[k]->lineNumberTracker;
+                    ft->cases[job.dest + k].source = switc->cases[k]->position;
+                    ft->cases[job.dest + k].body = r;
+                }
+                break;
+        }
     }
-    assert(false);
-    return NULL; // control never reaches here, this is just for the sake of GCC
+    free(jobs.job);
 }
 
+static void free_flat_tree(struct flat_tree* ft)
+{
+    free(ft->ids);
+    free(ft->decls);
+    free(ft->stmts);
+    free(ft->exprs);
+    free(ft->cases);
+    memset(ft, 0, sizeof(*ft));
+}
 
 
-//Error Code 0:
-void check_duplicate_declarations() {
+//Duplicate case labels:
+static void check_duplicate_case_labels(struct checker* ctx, struct flat_tree* ft) {
 
-    int i, j;
+    struct flat_case* cas;
+    uint32_t i, k;
 
-    for (i = 0; i < type_id_count; i++) {
+    // Each switch's cases are sorted by label, so a label that occurs
+    // more than once shows up as neighbours with the same num
+    for (i = 0; i < ft->stmts_count; i++) {
 
-        for (j = i + 1; j < type_id_count; j++) {
+        if (ft->stmts[i].stmtType != SWITCH) {
+            continue;
+        }
+        cas = &ft->cases[ft->stmts[i].switc.cases.start];
+        for (k = 1; k < ft->stmts[i].switc.cases.count; k++) {
 
-            if (strcmp(type_ids[i], type_ids[j]) == 0) {
+            if (cas[k].num == cas[k - 1].num && (k == 1 || cas[k - 2].num != cas[k].num)) {
 
-                printf("ERROR CODE 0 %s\n", type_ids[i]);
-                error_found = 1;
-                break;
+                report(ctx, "DUPLICATE CASE %d line %d\n", cas[k].num, cas[k].lineNumberTracker);
+                ctx->error_found = 1;
             }
         }
     }
 }
 
-//Error Code 1:
-void check_type_redec_var() {
+/* -------------------- TYPE CHECKS -------------------- */
+
+/*
+ * Types are compared by the root of their union-find class, see
+ * find_type(), so two variables declared with the same type name have the
+ * same type even when it leads to no built in type. A variable declared
+ * by its first use has a class of its own that takes the first type it is
+ * matched with, see match_types(). NO_TYPE is the type of an expression
+ * whose operands do not match; it matches any type, so the error is not
+ * reported again by every node above it. NUM_TYPE is that of an integer
+ * literal, or of an expression of them only, and matches both INT and
+ * LONG.
+ */
+#define NO_TYPE UINT32_MAX
+#define NUM_TYPE (UINT32_MAX - 1)
+
+// Statements still to be checked, and the DO statement whose condition
+// follows them
+struct type_frame
+{
+    struct flat_range stmts;
+    node_index loop; // NO_NODE for none
+};
+
+struct type_check
+{
+    uint32_t* expr_type; // side table, the type of each node of ft->exprs
+    node_index* stack;   // expression nodes not typed yet
+    uint32_t stack_capacity;
+    struct type_frame* frame; // bodies being checked, innermost last
+    uint32_t frame_count;
+    uint32_t frame_capacity;
+    uint32_t* order;          // a switch's cases in source order
+    uint32_t order_capacity;
+};
 
-    //This function needs to check to see if there is a multiple
-    //definintion redeclaration of items in the type section
-    //that are also existent as a left-hand side item in teh variable dec section
+// A broken type constraint:
+//   C1  both sides of an assignment have the same type
+//   C2  both operands of PLUS, MINUS, MULT and DIV have the same type
+//   C3  both operands of a relational operator have the same type
+//   C4  a condition without a relational operator is a BOOLEAN
+// where an integer literal has the type of an INT or a LONG
+static void report_mismatch(struct checker* ctx, int line, int constraint)
+{
+    report(ctx, "TYPE MISMATCH C%d line %d\n", constraint, line);
+    ctx->error_found = 1;
+}
 
-    int x, y;
-    int size_of_type_list = type_id_count;
-    int size_of_var_id_list = var_id_count;
+// Type of a variable, NO_TYPE for a name that is not one. A declared
+// variable's class is cached, see resolve_type_aliases(); only that of an
+// implicitly declared one can still join another, see match_types().
+static uint32_t variable_type(struct checker* ctx, symbol id)
+{
+    struct symbol_entry* entry = symbol_lookup(&ctx->symbols, id);
 
-    //If the type list is bigger than the var list, outer loop for type list
-    if (size_of_type_list > size_of_var_id_list)
+    if (entry == NULL || !(entry->kind & SYM_VAR))
     {
-        for (x = 0; x < size_of_type_list; x++)
-        {
-            for (y = 0; y < size_of_var_id_list; y++)
-            {
-                if (strcmp(type_ids[x], var_ids[y]) == 0)
-                {
-                    printf("ERROR CODE 1 %s", type_ids[x]);
-                    error_found = 1;
-                    break;
-                }
-            }
+        return NO_TYPE;
+    }
+    if (!(entry->kind & SYM_IMPLICIT))
+    {
+        return entry->type_class;
+    }
+    return find_type(&ctx->types, BUILTIN_TYPES + (entry - ctx->symbols.entry));
+}
 
-            if (error_found == 1)
-            {
-                break;
-            }
-        }
+static uint32_t primary_type(struct checker* ctx, struct flat_expr* e)
+{
+    switch (e->tag)
+    {
+        case NUM:
+            return NUM_TYPE;
+        case REALNUM:
+            return type_node(ctx, REAL, 0);
+        default:
+            return variable_type(ctx, e->id);
     }
+}
+
+// Whether the class with this root is that of variables declared by their
+// first use, which has no type yet
+static inline bool implicit_type(struct checker* ctx, uint32_t root)
+{
+    return root >= BUILTIN_TYPES && (ctx->symbols.entry[root - BUILTIN_TYPES].kind & SYM_IMPLICIT);
+}
 
-    //If var list is bigger than type list, outer loop for var list
+// Whether an integer literal can have type t. A class with no type yet
+// takes INT, the type a literal used to give it.
+static bool match_number(struct checker* ctx, uint32_t t)
+{
+    uint32_t int_type = type_node(ctx, INT, 0);
 
-    else if (size_of_type_list < size_of_var_id_list)
+    if (t == NUM_TYPE)
     {
-        for (x = 0; x < size_of_var_id_list; x++)
-        {
-            for (y = 0; y < size_of_type_list; y++)
-            {
-                if (strcmp(type_ids[y], var_ids[x]) == 0)
-                {
-                    printf("ERROR CODE 1 %s", type_ids[x]);
-                    error_found = 1;
-                    break;
-                }
-            }
+        return true;
+    }
+    t = find_type(&ctx->types, t);
+    if (t == int_type || t == type_node(ctx, LONG, 0))
+    {
+        return true;
+    }
+    if (implicit_type(ctx, t))
+    {
+        ctx->types.parent[t] = int_type;
+        return true;
+    }
+    return false;
+}
 
-            if (error_found == 1)
-            {
-                break;
-            }
-        }
+/*
+ * Whether types a and b are the same. A class with no type yet joins the
+ * other one, so the first use of an implicitly declared variable gives it
+ * its type and every later use has to agree.
+ */
+static bool match_types(struct checker* ctx, uint32_t a, uint32_t b)
+{
+    if (a == NUM_TYPE || b == NUM_TYPE)
+    {
+        return match_number(ctx, a == NUM_TYPE ? b : a);
+    }
+    a = find_type(&ctx->types, a);
+    b = find_type(&ctx->types, b);
+    if (a == b)
+    {
+        return true;
+    }
+    if (implicit_type(ctx, a))
+    {
+        ctx->types.parent[a] = b;
+        return true;
+    }
+    if (implicit_type(ctx, b))
+    {
+        ctx->types.parent[b] = a;
+        return true;
     }
+    return false;
+}
 
-    //If both lists are equal, either or
+/*
+ * Types the expression at root bottom-up into tc->expr_type and returns
+ * its type. The walk is post-order with an explicit stack, so expressions
+ * of any depth are fine: a node is typed once its right operand, which is
+ * typed after the left one, was the last node typed.
+ */
+static uint32_t type_of_expression(struct checker* ctx, struct type_check* tc, node_index root, int line)
+{
+    struct flat_expr* e;
+    node_index n, last = NO_NODE;
+    uint32_t top = 0, left, right;
 
-    else if (size_of_type_list == size_of_var_id_list)
+    if (tc->stack_capacity == 0)
     {
-        for (x = 0; x < size_of_var_id_list; x++)
+        tc->stack_capacity = 64;
+        tc->stack = malloc(tc->stack_capacity * sizeof(*tc->stack));
+    }
+    tc->stack[top++] = root;
+    while (top > 0)
+    {
+        n = tc->stack[top - 1];
+        e = &ctx->flat.exprs[n];
+        if (e->tag == EXPR && last != e->right)
         {
-            for (y = 0; y < size_of_type_list; y++)
-            {
-                if (strcmp(type_ids[x], var_ids[y]) == 0)
-                {
-                    printf("ERROR CODE 1 %s", type_ids[x]);
-                    error_found = 1;
-                    break;
-                }
-            }
-
-            if (error_found == 1)
+            if (top + 2 > tc->stack_capacity)
             {
-                break;
+                tc->stack_capacity *= 2;
+                tc->stack = realloc(tc->stack, tc->stack_capacity * sizeof(*tc->stack));
             }
+            tc->stack[top++] = e->right;
+            tc->stack[top++] = e->left;
+            continue;
+        }
+        top--;
+        last = n;
+        if (e->tag != EXPR)
+        {
+            tc->expr_type[n] = primary_type(ctx, e);
+            continue;
+        }
+        left = tc->expr_type[e->left];
+        right = tc->expr_type[e->right];
+        if (left == NO_TYPE || right == NO_TYPE)
+        {
+            tc->expr_type[n] = NO_TYPE;
+        }
+        else if (!match_types(ctx, left, right))
+        {
+            report_mismatch(ctx, line, 2);
+            tc->expr_type[n] = NO_TYPE;
+        }
+        else if (left == NUM_TYPE)
+        {
+            // A literal takes the type of the other operand
+            tc->expr_type[n] = right == NUM_TYPE ? NUM_TYPE : find_type(&ctx->types, right);
+        }
+        else
+        {
+            tc->expr_type[n] = find_type(&ctx->types, left);
         }
     }
+    return tc->expr_type[root];
+}
 
-    //ELSE compare first items
+// Condition operands are primaries, typed straight from the symbol table
+static void check_condition(struct checker* ctx, struct flat_stmt* stm)
+{
+    struct flat_expr* exprs = ctx->flat.exprs;
+    uint32_t lhs = primary_type(ctx, &exprs[stm->loop.left]);
+    uint32_t rhs;
 
-    else if (strcmp(type_ids[0], var_ids[0]) == 0)
+    if (stm->loop.right == NO_NODE)
+    {
+        if (lhs != NO_TYPE && !match_types(ctx, lhs, type_node(ctx, BOOLEAN, 0)))
+        {
+            report_mismatch(ctx, stm->loop.lineNumberTracker, 4);
+        }
+        return;
+    }
+    rhs = primary_type(ctx, &exprs[stm->loop.right]);
+    if (lhs != NO_TYPE && rhs != NO_TYPE && !match_types(ctx, lhs, rhs))
     {
-        printf("ERROR CODE 1 %s", type_ids[0]);
-        error_found = 1;
-        // break;
+        report_mismatch(ctx, stm->loop.lineNumberTracker, 3);
     }
 }
 
-//Error Code 2
-void check_var_dec_multiple() {
-
-    int i, j;
-
-    for (i = 0; i < var_id_count; i++) {
-
-        for (j = i + 1; j < var_id_count; j++) {
-
-            if (strcmp(var_ids[i], var_ids[j]) == 0) {
-
-                printf("ERROR CODE 2 %s", var_ids[i]);
-                error_found = 1;
-                break;
-            }
-        }
+static void push_type_frame(struct type_check* tc, struct flat_range stmts, node_index loop)
+{
+    if (tc->frame_count == tc->frame_capacity)
+    {
+        tc->frame_capacity = tc->frame_capacity ? 2 * tc->frame_capacity : 64;
+        tc->frame = realloc(tc->frame, tc->frame_capacity * sizeof(*tc->frame));
     }
+    tc->frame[tc->frame_count].stmts = stmts;
+    tc->frame[tc->frame_count].loop = loop;
+    tc->frame_count++;
 }
 
-//Error Code 4
-void check_var_dec_as_type() {
-
-    int x, y;
+// Queues the case bodies of a switch, the first one in the source on top
+static void push_case_frames(struct type_check* tc, struct flat_tree* ft, struct flat_stmt* stm)
+{
+    struct flat_case* cas = &ft->cases[stm->switc.cases.start];
+    uint32_t count = stm->switc.cases.count;
+    uint32_t k;
 
-    // printf("\n\nINSIDE FUNCTION\n");
+    if (count > tc->order_capacity)
+    {
+        tc->order_capacity = count;
+        tc->order = realloc(tc->order, tc->order_capacity * sizeof(*tc->order));
+    }
+    for (k = 0; k < count; k++)
+    {
+        tc->order[cas[k].source] = k;
+    }
+    for (k = count; k > 0; k--)
+    {
+        push_type_frame(tc, cas[tc->order[k - 1]].body, NO_NODE);
+    }
+}
 
-    //O(N^2) inefficient as fuck, should I sort and do binary search to make O(log(n))?
-    if (var_id_count > var_assign_count) {
+/*
+ * Checks the types of every statement in one pass, in source order, so
+ * the first use of an implicitly declared variable is the one that gives
+ * it its type. Nested bodies are walked with an explicit stack of frames,
+ * and the mismatches are reported as they are found.
+ */
+static void check_statement_types(struct checker* ctx, struct flat_tree* ft)
+{
+    struct type_check tc;
+    struct flat_stmt* stm;
+    node_index i, loop;
+    uint32_t lhs, rhs;
 
-         // printf("\n\nFIRST\n");
-        for (x = 0; x < var_id_count; x++)
+    memset(&tc, 0, sizeof(tc));
+    tc.expr_type = malloc((ft->exprs_count + 1) * sizeof(*tc.expr_type));
+    push_type_frame(&tc, ft->body, NO_NODE);
+    while (tc.frame_count > 0)
+    {
+        if (tc.frame[tc.frame_count - 1].stmts.count == 0)
         {
-            for (y = 0; y < var_assign_count; y++)
+            // A DO statement's condition comes after its body
+            loop = tc.frame[--tc.frame_count].loop;
+            if (loop != NO_NODE)
             {
-                // printf("Analyzing %s and %s\n", var_ids[x], var_assigns[y]);
-                if (strcmp(var_ids[x], var_assigns[y]) == 0) {
-
-                    // printf("They were identical\n");
-                    printf("ERROR CODE 4 %s", (var_ids[x]));
-                    error_found = 1;
-                    break;
-                }
-            }
-
-            if (error_found == 1){
-                break;
+                check_condition(ctx, &ft->stmts[loop]);
             }
+            continue;
         }
-    }
-
-    else if (var_id_count < var_assign_count) {
-
-
-
-        for (x = 0; x < var_assign_count; x++)
+        i = tc.frame[tc.frame_count - 1].stmts.start++;
+        tc.frame[tc.frame_count - 1].stmts.count--;
+        stm = &ft->stmts[i];
+        switch (stm->stmtType)
         {
-            for (y = 0; y < var_id_count; y++)
-            {
-                // printf("Analyzing %s and %s\n", var_ids[x], var_assigns[y]);
-                if (strcmp(var_ids[y], var_assigns[x]) == 0) {
-
-                    // printf("They were identical\n");
-                    printf("ERROR CODE 4 %s", (var_assigns[x]));
-                    error_found = 1;
-                    break;
+            case ASSIGN:
+                lhs = variable_type(ctx, stm->assign.id);
+                rhs = type_of_expression(ctx, &tc, stm->assign.expr, stm->assign.lineNumberTracker);
+                if (lhs != NO_TYPE && rhs != NO_TYPE && !match_types(ctx, lhs, rhs))
+                {
+                    report_mismatch(ctx, stm->assign.lineNumberTracker, 1);
                 }
-            }
-
-            if (error_found == 1){
                 break;
-            }
-        }
-    }
-
-    else if (var_id_count == var_assign_count) {
-
-        // printf("\n\nTHIRD\n");
 
-        for (x = 0; x < var_assign_count; x++)
-        {
-            for (y = 0; y < var_id_count; y++)
-            {
-                // printf("Analyzing %s and %s\n", var_ids[x], var_assigns[y]);
-                if (strcmp(var_ids[x], var_assigns[y]) == 0) {
+            case WHILE:
+                check_condition(ctx, stm);
+                push_type_frame(&tc, stm->loop.body, NO_NODE);
+                break;
 
-                    // printf("They were identical\n");
-                    printf("ERROR CODE 4 %s", (var_ids[x]));
-                    error_found = 1;
-                    break;
-                }
-            }
+            case DO:
+                push_type_frame(&tc, stm->loop.body, i);
+                break;
 
-            if (error_found == 1){
+            case SWITCH:
+                push_case_frames(&tc, ft, stm);
                 break;
-            }
         }
     }
 
-    else if (strcmp(var_ids[0], var_assigns[0]) == 0) {
+    free(tc.expr_type);
+    free(tc.stack);
+    free(tc.frame);
+    free(tc.order);
+}
+
+/* -------------------- CHECKER INTERFACE -------------------- */
+
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static void init_tables()
+{
+    init_scanners();
+    init_parse_table();
+}
 
-        printf("ERROR CODE 4 %s", (var_ids[0]));
-        error_found = 1;
+struct checker* checker_new(const struct checker_options* options)
+{
+    struct checker* ctx;
 
+    pthread_once(&tables_once, init_tables);
+    ctx = calloc(1, sizeof(*ctx));
+    if (ctx == NULL)
+    {
+        return NULL;
+    }
+    ctx->options.max_syntax_errors = 100;
+    if (options != NULL)
+    {
+        ctx->options = *options;
     }
+    ctx->input_fd = -1;
+    ctx->names.text = &ctx->name_arena;
+    return ctx;
 }
 
+void checker_free(struct checker* ctx)
+{
+    if (ctx == NULL)
+    {
+        return;
+    }
+    free_tokens(ctx);
+    free_flat_tree(&ctx->flat);
+    free(ctx->parse.item);
+    free(ctx->parse.value);
+    free(ctx->parse.op);
+    free_interner(&ctx->names);
+    free_symbol_table(&ctx->symbols);
+    free_decl_state(&ctx->decls);
+    free_type_classes(&ctx->types);
+    arena_free(&ctx->tree_arena);
+    arena_free(&ctx->name_arena);
+    free(ctx);
+}
 
-int main()
+// Tokenizes and parses the input, then runs the checks in order up to the
+// first one that finds an error
+static int check_program(struct checker* ctx)
 {
     struct programNode* parseTree;
 
-    parseTree = program();
+    tokenize(ctx);
+    parseTree = program(ctx);
+    free_tokens(ctx);
+
+    // The checks walk the compact flat form of the tree; the pointer tree
+    // is released as soon as it is copied, its chunks kept for the next
+    // program
+    flatten_program(&ctx->flat, parseTree);
+    arena_release(&ctx->tree_arena);
 
-    print_parse_tree(parseTree); // This is just for debugging purposes
+    //Check Error Codes 0, 1, 2, 3 and 4, then alias cycles, in that
+    //order; they were found while parsing
+    report_declaration_errors(ctx);
+    if (ctx->error_found == 0) {report_variable_uses(ctx);}
+    if (ctx->error_found == 0) {report_type_name_errors(ctx);}
 
-    // Check Error Code 0:
-    check_duplicate_declarations();
+    //Check for repeated case labels:
+    if (ctx->error_found == 0) {check_duplicate_case_labels(ctx, &ctx->flat);}
 
-    //Check Error Code 1:
-    if (error_found == 0) {check_type_redec_var();}
+    //Check the types of assignments, expressions and conditions:
+    if (ctx->error_found == 0) {check_statement_types(ctx, &ctx->flat);}
 
-    //Check Error Code 2:
-    if (error_found == 0) {check_var_dec_multiple();}
+    // //All Checks Passed Successfully!
+    if (ctx->error_found == 0) {
+        report(ctx, "All systems go!");
+    }
+    return ctx->error_found ? CHECK_SEMANTIC_ERROR : CHECK_OK;
+}
 
-    // //Check Error Code 3:
+static int run_check(struct checker* ctx, checker_diag_fn diag, void* user)
+{
+    int status;
+
+    ctx->diag = diag;
+    ctx->diag_user = user;
+    ctx->syntax_error_count = 0;
+    ctx->error_found = 0;
+    clear_symbol_table(&ctx->symbols);
+    reset_decl_state(&ctx->decls);
+    ctx->types.count = 0;
+
+    // Errors that end the check early jump back here, see abort_check()
+    if (setjmp(ctx->check_abort) == 0)
+    {
+        ctx->abort_status = check_program(ctx);
+    }
+    status = ctx->abort_status;
+
+    // The whole tree and its names go in one step; the pointer tree is
+    // still in use when the check ended before it was flattened
+    free_tokens(ctx);
+    free_flat_tree(&ctx->flat);
+    arena_release(&ctx->tree_arena);
+    arena_release(&ctx->name_arena);
+    clear_interner(&ctx->names);
+    return status;
+}
 
-    //[DO THIS DURING PARSING] ??
+int check_buffer(struct checker* ctx, const char* data, size_t length,
+                 checker_diag_fn diag, void* user)
+{
+    int status;
+
+    ctx->input = length > 0 ? data : "";
+    ctx->input_length = length;
+    ctx->input_fd = -1;
+    ctx->input_mapped = false;
+    status = run_check(ctx, diag, user);
+    ctx->input = NULL;
+    ctx->input_length = 0;
+    return status;
+}
 
-    // //Check Error Code 4:
-    if (error_found == 0) {check_var_dec_as_type();}
+int check_file(struct checker* ctx, const char* path,
+               checker_diag_fn diag, void* user)
+{
+    int status;
 
-    // //All Checks Passed Successfully!
-    if (error_found == 0) {
-        printf("All systems go!");
+    if (open_input(ctx, path) < 0)
+    {
+        return CHECK_IO_ERROR;
     }
-
-    return 0;
+    status = run_check(ctx, diag, user);
+    close_input(ctx);
+    return status;
 }
@@ -1,33 +1,15 @@
 #ifndef __SYNTAX__H__
 #define __SYNTAX__H__
-#define INT_MAX 32767
+#include <stdint.h>
 /*----------------------------------------------------------------------------
  Note: the code in this file is not to be shared with anyone or posted online.
  (c) Rida Bazzi, 2015, Adam Doupe, 2015
  ----------------------------------------------------------------------------*/
-/* -------------------- GLOBAL VARIABLES -------------------- */
-
-int type_id_count = 0;
-int var_id_count = 0;
-int var_assign_count = 0;
-// int types_for_types = 0;
-
-int line_number_tracker = 0;
-
-int var_section_accessed = 0;
-int error_found = 0;
-
-const char *type_ids[INT_MAX];
-const char *var_ids[INT_MAX];
-const char *var_assigns[INT_MAX];
-// const char *types_for_types_assigns[INT_MAX];
-
-
-// const char* testing_type_name[INT_MAX];
-// const char* testing_type_value[INT_MAX];
-// int test_insert = 0;
-// int switched_to_var = 0;
+// Identifiers are interned, a symbol stands for one distinct name
+typedef uint32_t symbol;
 
+// Type check state lives in a checker context, see checker.h
+struct checker;
 
 /* -------------------- PARSE TREE TYPES -------------------- */
 
@@ -88,12 +70,13 @@ struct var_declNode
 struct type_nameNode
 {
     int type; // INT, REAL, STRING, BOOLEAN, ID, LONG
-    char* id; // actual string when type is ID
+    symbol id; // the name when type is ID
 };
 
 struct id_listNode
 {
-    char * id;
+    symbol id;
+    int lineNumberTracker;
     struct id_listNode* id_list;
 };
 
@@ -128,6 +111,7 @@ struct conditionNode
     int relop;
     struct primaryNode* left_operand;
     struct primaryNode* right_operand;
+    int lineNumberTracker;
 };
 
 struct while_stmtNode
@@ -138,7 +122,7 @@ struct while_stmtNode
 
 struct assign_stmtNode
 {
-    char* id;
+    symbol id;
     struct exprNode* expr;
     int lineNumberTracker;
 };
@@ -157,13 +141,15 @@ struct primaryNode
     int tag; // NUM, REALNUM or ID
     int ival;
     float fval;
-    char *id;
+    symbol id;
 };
 
 struct caseNode
 {
     int num;
     struct bodyNode* body;	// body of the case
+    int lineNumberTracker;
+    uint32_t position; // in the case list
 };
 
 struct case_listNode
@@ -174,76 +160,108 @@ struct case_listNode
 
 struct switch_stmtNode
 {
-    char* id;
+    symbol id;
     struct case_listNode* case_list;
+    struct caseNode** cases; // the same cases ordered by label
+    uint32_t case_count;
+};
+
+/* -------------------- FLAT PARSE TREE TYPES -------------------- */
+
+// The same tree kept in contiguous arrays: nodes refer to each other by
+// 32-bit index into their array and lists are (start, count) ranges.
+typedef uint32_t node_index;
+#define NO_NODE UINT32_MAX
+
+struct flat_range
+{
+    node_index start;
+    uint32_t count;
+};
+
+struct flat_decl // type_decl or var_decl
+{
+    struct flat_range ids; // into flat_tree.ids
+    int type; // INT, REAL, STRING, BOOLEAN, ID, LONG
+    symbol id; // the name when type is ID
+    int lineNumberTracker; // line of the first declared name
+};
+
+struct flat_expr
+{
+    uint16_t tag; // NUM, REALNUM, ID or EXPR
+    uint16_t op; // PLUS, MINUS, MULT or DIV when tag is EXPR
+    union
+    {
+        int ival;
+        float fval;
+        symbol id;
+        struct
+        {
+            node_index left;
+            node_index right;
+        };
+    };
+};
+
+struct flat_stmt
+{
+    uint8_t stmtType; // WHILE, ASSIGN, DO, or SWITCH
+    uint8_t relop; // relop of a WHILE or DO condition, 0 without one
+    union
+    {
+        struct
+        {
+            symbol id;
+            node_index expr;
+            int lineNumberTracker;
+        } assign;
+        struct
+        {
+            // Condition operands are primaries in flat_tree.exprs,
+            // right is NO_NODE for a single operand
+            node_index left;
+            node_index right;
+            struct flat_range body;
+            int lineNumberTracker; // line of the condition
+        } loop; // WHILE and DO
+        struct
+        {
+            symbol id;
+            struct flat_range cases;
+        } switc;
+    };
+};
+
+struct flat_case // a switch's cases are ordered by num
+{
+    int num;
+    int lineNumberTracker;
+    uint32_t source; // position among the switch's cases in the source
+    struct flat_range body;
+};
+
+struct flat_tree
+{
+    struct flat_range type_decls; // into decls
+    struct flat_range var_decls;
+    struct flat_range body; // into stmts
+
+    symbol* ids;
+    uint32_t ids_count, ids_capacity;
+    struct flat_decl* decls;
+    uint32_t decls_count, decls_capacity;
+    struct flat_stmt* stmts;
+    uint32_t stmts_count, stmts_capacity;
+    struct flat_expr* exprs;
+    uint32_t exprs_count, exprs_capacity;
+    struct flat_case* cases;
+    uint32_t cases_count, cases_capacity;
 };
 
 /* -------------------- PARSE TREE FUNCTIONS -------------------- */
 
-#define ALLOC(t) (t*) calloc(1, sizeof(t))
-
-void print_decl(struct declNode* dec);
-void print_body(struct bodyNode* body);
-
-void print_type_decl_section(struct type_decl_sectionNode* typeDeclSection);
-void print_type_decl_list(struct type_decl_listNode* typeDeclList);
-void print_type_decl(struct type_declNode* typeDecl);
-
-void print_var_decl_section(struct var_decl_sectionNode* varDeclSection);
-void print_var_decl_list(struct var_decl_listNode* varDeclList);
-void print_var_decl(struct var_declNode* varDecl);
-void print_type_name(struct type_nameNode* typeName);
-void print_id_list(struct id_listNode* idList);
-void print_id_list(struct id_listNode* idList);
-
-void print_stmt_list(struct stmt_listNode* stmt_list);
-void print_stmt(struct stmtNode* stmt);
-void print_assign_stmt(struct assign_stmtNode* assign_stmt);
-void print_expression_prefix(struct exprNode* expr);
-void print_while_stmt(struct while_stmtNode* while_stmt);
-void print_do_stmt(struct while_stmtNode* do_stmt);
-void print_condition(struct conditionNode* condition);
-void print_case(struct caseNode* cas);
-void print_case_list(struct case_listNode* case_list);
-void print_switch_stmt(struct switch_stmtNode* switc);
-
-/* -------------------- TYPE CHECK FUNCTIONS ----------------- */
-
-// void check_multiple_instances();
-void check_duplicate_declarations();
-void check_type_redec_var();
-void check_var_dec_multiple();
-void check_var_dec_as_type();
-
-void check_pointer_array_duplicates(char * arr1[], int sizeofArr1, char * arr2[], int sizeofArr2);
-
-char * getTypeOfType(char *type);
-
-/* -------------------- PARSING FUNCTIONS -------------------- */
-
-struct programNode*           program();
-struct declNode*              decl();
-struct type_decl_sectionNode* type_decl_section();
-struct var_decl_sectionNode*  var_decl_section();
-struct type_decl_listNode*    type_decl_list();
-struct var_decl_listNode*     var_decl_list();
-struct var_declNode*          var_decl();
-struct type_declNode*         type_decl();
-struct id_listNode*           id_list();
-struct type_nameNode*         type_name();
-struct bodyNode*              body();
-struct stmt_listNode*         stmt_list();
-struct stmtNode*              stmt();
-struct while_stmtNode*        while_stmt();
-struct assign_stmtNode*       assign_stmt();
-struct exprNode*              expr();
-struct exprNode*              term();
-struct exprNode*              factor();
-struct conditionNode*         condition();
-struct primaryNode*           primary();
-struct caseNode*              cas();
-struct case_listNode*         case_list();
-struct switch_stmtNode*       switch_stmt();
-struct while_stmtNode*        do_stmt();
+// Nodes come zeroed from the parse tree arena, see arena_alloc()
+#define ALLOC(ctx, t) (t*) arena_alloc(&(ctx)->tree_arena, sizeof(t), _Alignof(t))
 
 #endif //__SYNTAX__H__